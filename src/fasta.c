@@ -34,6 +34,392 @@
 
 #include "fasta.h"
 
+/**
+ * @def FASTA_EMPTY_SLOT
+ *   The index used to mark an empty slot in the hash table of identifiers.
+ */
+#define FASTA_EMPTY_SLOT SIZE_MAX
+
+/**
+ * The smallest part of a fasta file indexed by each thread.
+ */
+static size_t fastaChunkSize = FASTA_CHUNK_SIZE;
+
+/**
+ * The state of the indexer between the blocks of a fasta file.
+ *
+ * @private
+ */
+typedef struct FastaIndexer {
+  char * id;                       /**< The identifier being read. */
+  size_t idLength;                 /**< The length of the identifier. */
+  size_t idCapacity;               /**< The size of the identifier buffer. */
+  size_t lineBases;                /**< The nucleotides on the line. */
+  size_t lineWidth;                /**< The bytes on the line. */
+  int lineStart;                   /**< True at the start of a line. */
+  int inHeader;                    /**< True on a header line. */
+  int inIdentifier;                /**< True in the identifier. */
+  int counting;                    /**< True while counting nucleotides. */
+  int lastLine;                    /**< True after a short line. */
+} FastaIndexer;
+
+/**
+ * Make room for more sequences in the arrays of this Fasta object.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param capacity The number of sequences to make room for.
+ */
+static void growFasta (
+  Fasta * fasta,
+  size_t capacity
+);
+
+/**
+ * Store the identifier of a sequence at the end of the identifier arena.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence.
+ * @param id The identifier, which need not be terminated by a null
+ *        character.
+ * @param length The length of the identifier.
+ */
+static void addIdentifier (
+  Fasta * fasta,
+  size_t index,
+  const char * id,
+  size_t length
+);
+
+/**
+ * Index the sequences in the fasta file in a single pass.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @return The number of sequences found, or 0 if the file can not be
+ *         read.
+ */
+static size_t indexFasta (
+  Fasta * fasta
+);
+
+/**
+ * Index the sequences in the fasta file in chunks, one on each thread.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param fileSize The size of the fasta file.
+ * @param chunks The number of chunks.
+ * @return The number of sequences found, or 0 if a chunk can not be read.
+ */
+static size_t indexChunks (
+  Fasta * fasta,
+  size_t fileSize,
+  size_t chunks
+);
+
+/**
+ * Find the first header line that starts in part of the fasta file.
+ *
+ * @private
+ * @param file The file descriptor of the fasta file.
+ * @param start The file offset of the start of the part.
+ * @param end The file offset of the end of the part.
+ * @return The file offset of the header line, or end if there is none.
+ */
+static size_t findHeader (
+  int file,
+  size_t start,
+  size_t end
+);
+
+/**
+ * Index the sequences in a block of the fasta file.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param indexer The state of the indexer.
+ * @param buffer The block of the fasta file.
+ * @param length The length of the block.
+ * @param offset The file offset of the block.
+ */
+static void indexBlock (
+  Fasta * fasta,
+  FastaIndexer * indexer,
+  char * buffer,
+  size_t length,
+  size_t offset
+);
+
+/**
+ * Finish the last sequence at the end of the indexed part of the file.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param indexer The state of the indexer.
+ * @param offset The file offset of the end of the indexed part.
+ */
+static void finishIndex (
+  Fasta * fasta,
+  FastaIndexer * indexer,
+  size_t offset
+);
+
+/**
+ * Add a line of sequence data to the index of a sequence.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence.
+ * @param bases The number of nucleotides on the line.
+ * @param width The number of bytes on the line.
+ * @param lastLine Set once a line shorter than the first line is found.
+ */
+static void indexLine (
+  Fasta * fasta,
+  size_t index,
+  size_t bases,
+  size_t width,
+  int * lastLine
+);
+
+/**
+ * Read the index at the start of a UCSC .2bit file.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @return The number of sequences found, or 0 if the file is not a .2bit
+ *         file.
+ */
+static size_t readTwoBitIndex (
+  Fasta * fasta
+);
+
+/**
+ * Read words from a UCSC .2bit file, in the byte order of the file.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param words The words to read.
+ * @param number The number of words to read.
+ * @param offset The file offset of the words, moved past them.
+ * @return True if every word was read.
+ */
+static int readTwoBitWords (
+  Fasta * fasta,
+  uint32_t * words,
+  size_t number,
+  size_t * offset
+);
+
+/**
+ * Parse a sequence from a UCSC .2bit file into packed nucleotides.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence.
+ * @param seq The sequence object to fill.
+ * @return True if the sequence was parsed, false if the sequence record is
+ *         cut short.
+ */
+static int parseTwoBit (
+  Fasta * fasta,
+  size_t index,
+  Sequence * seq
+);
+
+/**
+ * Read a list of blocks from the record of a sequence in a UCSC .2bit
+ * file, the number of blocks followed by their starts and their sizes.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param base The character of the runs.
+ * @param number Set to the number of blocks.
+ * @param offset The file offset of the list, moved past it.
+ * @return The blocks as runs, or NULL if the list is cut short.
+ */
+static PackedRun * readTwoBitBlocks (
+  Fasta * fasta,
+  char base,
+  size_t * number,
+  size_t * offset
+);
+
+/**
+ * Read the index of the sequences from an index file.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param indexName The name of the index file.
+ * @param fileStat The status of the fasta file.
+ * @return The number of sequences found, or 0 if the index file is missing
+ *         or out of date.
+ */
+static size_t readFastaIndex (
+  Fasta * fasta,
+  char * indexName,
+  struct stat * fileStat
+);
+
+/**
+ * Write the index of the sequences to an index file.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param indexName The name of the index file.
+ */
+static void writeFastaIndex (
+  Fasta * fasta,
+  char * indexName
+);
+
+/**
+ * Find the index of the next sequence that is long enough.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param index Set to the index of the next sequence.
+ * @return True while there are still sequences in the buffer.
+ */
+static int nextIndex (
+  Fasta * fasta,
+  size_t * index
+);
+
+/**
+ * Read and parse a sequence from the fasta file.
+ *
+ * The header line and the sequence data are read with readAt into the
+ * buffers of the sequence object, and the line breaks are dropped in
+ * place.  Nothing is shared but the index, so several threads can read
+ * sequences at once, each into its own sequence object.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence.
+ * @param seq The sequence object to fill.
+ * @return True if the sequence was parsed, false if it could not be read
+ *         in full.
+ */
+static int readSequence (
+  Fasta * fasta,
+  size_t index,
+  Sequence * seq
+);
+
+/**
+ * Fill a sequence object with the sequence at an index in the fasta file,
+ * as a view of the mapped file when there is one.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence.
+ * @param seq The sequence object to fill.
+ * @return True if the sequence was found.
+ */
+static int fillSequence (
+  Fasta * fasta,
+  size_t index,
+  Sequence * seq
+);
+
+/**
+ * Hash a sequence identifier with the 64-bit FNV-1a hash.
+ *
+ * @private
+ * @param id The identifier.
+ * @return The hash of the identifier.
+ */
+static uint64_t hashIdentifier (
+  char * id
+);
+
+/**
+ * Build the hash table of identifiers used by getSequenceById.
+ *
+ * The table is an open addressing table of sequence indices, kept at most
+ * half full.  The table is never changed afterwards, so it can be read by
+ * several threads at once.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ */
+static void buildIdTable (
+  Fasta * fasta
+);
+
+/**
+ * Parse the next sequence from a fasta file read as a stream.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param seq The sequence object to fill.
+ * @return True while there are still sequences in the stream.
+ */
+static int nextStreamSequence (
+  Fasta * fasta,
+  Sequence * seq
+);
+
+/**
+ * Find the file offset of the header line of a sequence.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence.
+ * @return The file offset of the header line.
+ */
+static size_t headerOffset (
+  Fasta * fasta,
+  size_t index
+);
+
+/**
+ * Read part of the fasta file at a file offset.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param buffer The buffer to read into.
+ * @param length The number of bytes to read.
+ * @param offset The file offset of the first byte.
+ * @return The number of bytes read, less than length at the end of the
+ *         file.
+ */
+static size_t readAt (
+  Fasta * fasta,
+  void * buffer,
+  size_t length,
+  size_t offset
+);
+
+/**
+ * Parse a sequence from a fasta file read as a stream.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param seq The sequence object to fill.
+ * @return True if a sequence was parsed.
+ */
+static int parseSequence (
+  Fasta * fasta,
+  Sequence * seq
+);
+
+/**
+ * Parse a sequence from a FASTQ file.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param seq The sequence object to fill.
+ * @return True if a sequence was parsed.
+ */
+static int parseFastq (
+  Fasta * fasta,
+  Sequence * seq
+);
+
 /**
  * Creates a new Fasta object from the given fasta formatted file.
  *
@@ -42,221 +428,1983 @@
  * @param fileName The fasta formatted file to create this object from.
  * @return The new Fasta object.
  */
-Fasta * newFasta (
-  char * fileName
+Fasta * newFasta (
+  char * fileName
+) {
+  Fasta * fasta;
+  FILE * file;
+  Gzip * gzip;
+  struct stat fileStat;
+  char * indexName;
+  int c;
+  /* Read standard input, pipes and other files that can not seek as a
+     stream. */
+  if (strcmp (fileName, "-") == 0) {
+    return newFastaStream (stdin);
+  }
+  if (stat (fileName, &fileStat) == 0 && ! S_ISREG (fileStat.st_mode)) {
+    file = fopen (fileName, "r");
+    if (file == NULL) {
+      return NULL;
+    }
+    return newFastaStream (file);
+  }
+  fasta = malloc (sizeof (Fasta));
+  /* Open the fasta file with read access, decompressing it as it is read
+     if it is gzip compressed. */
+  fasta->gzip = newGzip (fileName);
+  if (fasta->gzip != NULL) {
+    fasta->file = streamGzip (fasta->gzip);
+  }
+  else {
+    fasta->file = fopen (fileName, "r");
+  }
+  /* Verify that the fasta file is open. */
+  if (fasta->file == NULL) {
+    if (fasta->gzip != NULL) {
+      freeGzip (fasta->gzip);
+    }
+    free (fasta);
+    return NULL;
+  }
+  /* Read the sequences of a file that is not compressed with positional
+     reads. */
+  fasta->descriptor = fasta->gzip == NULL ? fileno (fasta->file) : -1;
+  /* FASTQ files start with an '@', and are read as a stream.  A gzip file
+     that is not BGZF can only be decompressed from the beginning, so it is
+     read as a stream too. */
+  c = getc (fasta->file);
+  ungetc (c, fasta->file);
+  if (c == '@' || (fasta->gzip != NULL && ! fasta->gzip->bgzf)) {
+    file = fasta->file;
+    gzip = fasta->gzip;
+    free (fasta);
+    fasta = newFastaStream (file);
+    if (fasta == NULL) {
+      if (gzip != NULL) {
+        freeGzip (gzip);
+      }
+      return NULL;
+    }
+    fasta->gzip = gzip;
+    return fasta;
+  }
+  /* Find the identifier, length and file offset of each sequence, from
+     the index file if it is up to date. */
+  fasta->idArena = NULL;
+  fasta->idArenaSize = 0;
+  fasta->idArenaCapacity = 0;
+  fasta->idOffsets = NULL;
+  fasta->lengths = NULL;
+  fasta->offsets = NULL;
+  fasta->sequenceOffsets = NULL;
+  fasta->lineBases = NULL;
+  fasta->lineWidths = NULL;
+  fasta->regular = 1;
+  fasta->capacity = 0;
+  indexName = malloc (
+    (strlen (fileName) + strlen (FASTA_INDEX_EXTENSION) + 1) * sizeof (char)
+  );
+  sprintf (indexName, "%s%s", fileName, FASTA_INDEX_EXTENSION);
+  /* A UCSC .2bit file has an index of its own. */
+  fasta->size = readTwoBitIndex (fasta);
+  if (stat (fileName, &fileStat) == 0) {
+    /* The index file of a BGZF file describes the decompressed data. */
+    if (fasta->gzip != NULL) {
+      fileStat.st_size = fasta->gzip->size;
+    }
+    if (! fasta->twoBit) {
+      fasta->size = readFastaIndex (fasta, indexName, &fileStat);
+    }
+  }
+  else {
+    fileStat.st_size = 0;
+  }
+  if (fasta->size == 0 && ! fasta->twoBit) {
+    fasta->size = indexFasta (fasta);
+    /* Only sequences with lines of the same length can be indexed in the
+       index file. */
+    if (fasta->size > 0 && fasta->regular) {
+      writeFastaIndex (fasta, indexName);
+    }
+  }
+  free (indexName);
+  /* Map the fasta file in memory for views of the sequences. */
+  fasta->map = NULL;
+  fasta->mapSize = 0;
+  if (
+    fasta->gzip == NULL && fasta->size > 0 && fasta->regular &&
+    fileStat.st_size > 0
+  ) {
+    fasta->mapSize = fileStat.st_size;
+    fasta->map = mmap (
+      NULL, fasta->mapSize, PROT_READ, MAP_PRIVATE, fileno (fasta->file), 0
+    );
+    if (fasta->map == MAP_FAILED) {
+      fasta->map = NULL;
+      fasta->mapSize = 0;
+    }
+  }
+  /* Verify that the fasta has at least one sequence. */
+  if (fasta->size == 0) {
+    fclose (fasta->file);
+    if (fasta->gzip != NULL) {
+      freeGzip (fasta->gzip);
+    }
+    free (fasta->idArena);
+    free (fasta->idOffsets);
+    free (fasta->lengths);
+    free (fasta->offsets);
+    free (fasta->sequenceOffsets);
+    free (fasta->lineBases);
+    free (fasta->lineWidths);
+    free (fasta);
+    return NULL;
+  }
+  fseek (fasta->file, 0, SEEK_SET);
+  /* Default to a minimum sequence length of 1. */
+  fasta->minimumLength = 1;
+  /* Set the current sequence as the first found in the file. */
+  fasta->current = 0;
+  fasta->streaming = 0;
+  fasta->fastq = 0;
+  fasta->minimumQuality = 0;
+  fasta->line = NULL;
+  fasta->lineSize = 0;
+  /* Index the identifiers for getSequenceById. */
+  buildIdTable (fasta);
+  return fasta;
+}
+
+/**
+ * Creates a new Fasta object that reads the sequences from a stream.
+ *
+ * @memberof Fasta
+ * @public
+ * @param file The stream to read the sequences from.
+ * @return The new Fasta object, or NULL if the stream holds no sequences.
+ */
+Fasta * newFastaStream (
+  FILE * file
+) {
+  Fasta * fasta;
+  char * line = NULL;
+  size_t lineSize = 0;
+  int fastq;
+  int c;
+  /* A FASTQ file starts with the '@' of its first header line. */
+  c = getc (file);
+  fastq = c == '@';
+  /* Skip anything before the first header line of a fasta file. */
+  while (! fastq && c != EOF && c != '>') {
+    ungetc (c, file);
+    if (getline (&line, &lineSize, file) < 0) {
+      break;
+    }
+    c = getc (file);
+  }
+  free (line);
+  /* Verify that the stream has at least one sequence. */
+  if (c == EOF) {
+    if (file != stdin) {
+      fclose (file);
+    }
+    return NULL;
+  }
+  ungetc (c, file);
+  fasta = malloc (sizeof (Fasta));
+  fasta->file = file;
+  fasta->gzip = NULL;
+  fasta->descriptor = -1;
+  fasta->size = 0;
+  fasta->idArena = NULL;
+  fasta->idArenaSize = 0;
+  fasta->idArenaCapacity = 0;
+  fasta->idOffsets = NULL;
+  fasta->lengths = NULL;
+  fasta->offsets = NULL;
+  fasta->sequenceOffsets = NULL;
+  fasta->lineBases = NULL;
+  fasta->lineWidths = NULL;
+  fasta->regular = 0;
+  fasta->map = NULL;
+  fasta->mapSize = 0;
+  fasta->minimumLength = 1;
+  fasta->current = 0;
+  fasta->streaming = 1;
+  fasta->capacity = 0;
+  fasta->fastq = fastq;
+  fasta->minimumQuality = 0;
+  fasta->idTable = NULL;
+  fasta->idTableSize = 0;
+  fasta->twoBit = 0;
+  fasta->swapped = 0;
+  fasta->line = NULL;
+  fasta->lineSize = 0;
+  return fasta;
+}
+
+/**
+ * Retrieves the next sequence from the fasta file.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param seq The sequence to be returned.
+ * @return True while there are still sequences in the buffer.
+ */
+int nextSequence (
+  Fasta * fasta,
+  Sequence ** seq
+) {
+  Sequence * next = newSequence ();
+  if (! nextSequenceInto (fasta, next)) {
+    freeSequence (next);
+    return 0;
+  }
+  *seq = next;
+  return 1;
+}
+
+/**
+ * Retrieves a view of the next sequence in the fasta file.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param seq The sequence to be returned.
+ * @return True while there are still sequences in the buffer.
+ */
+int nextSequenceView (
+  Fasta * fasta,
+  Sequence ** seq
+) {
+  Sequence * next = newSequence ();
+  if (! nextSequenceViewInto (fasta, next)) {
+    freeSequence (next);
+    return 0;
+  }
+  *seq = next;
+  return 1;
+}
+
+/**
+ * Retrieves the next sequence from the fasta file into a sequence object
+ * owned by the caller.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param seq The sequence object to fill, created with newSequence.
+ * @return True while there are still sequences in the buffer.
+ */
+int nextSequenceInto (
+  Fasta * fasta,
+  Sequence * seq
+) {
+  size_t index;
+  if (fasta->streaming) {
+    return nextStreamSequence (fasta, seq);
+  }
+  if (! nextIndex (fasta, &index)) {
+    return 0;
+  }
+  return readSequence (fasta, index, seq);
+}
+
+/**
+ * Retrieves a view of the next sequence in the fasta file into a sequence
+ * object owned by the caller.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param seq The sequence object to fill, created with newSequence.
+ * @return True while there are still sequences in the buffer.
+ */
+int nextSequenceViewInto (
+  Fasta * fasta,
+  Sequence * seq
+) {
+  size_t index;
+  if (fasta->map == NULL) {
+    return nextSequenceInto (fasta, seq);
+  }
+  if (! nextIndex (fasta, &index)) {
+    return 0;
+  }
+  return fillSequence (fasta, index, seq);
+}
+
+/**
+ * Retrieves the sequence at an index in the fasta file.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence in the fasta file.
+ * @return The sequence, which should be freed by the caller, or NULL if
+ *         the index is past the last sequence or the fasta file is read as
+ *         a stream.
+ */
+Sequence * getSequenceByIndex (
+  Fasta * fasta,
+  size_t index
+) {
+  Sequence * seq;
+  if (fasta->streaming || index >= fasta->size) {
+    return NULL;
+  }
+  seq = newSequence ();
+  if (! fillSequence (fasta, index, seq)) {
+    freeSequence (seq);
+    return NULL;
+  }
+  return seq;
+}
+
+/**
+ * Retrieves the sequence at an index in the fasta file into a sequence
+ * object owned by the caller.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence in the fasta file.
+ * @param seq The sequence object to fill, created with newSequence.
+ * @return True if the sequence was found, false if the index is past the
+ *         last sequence or the fasta file is read as a stream.
+ */
+int getSequenceByIndexInto (
+  Fasta * fasta,
+  size_t index,
+  Sequence * seq
+) {
+  if (fasta->streaming || index >= fasta->size) {
+    return 0;
+  }
+  return fillSequence (fasta, index, seq);
+}
+
+/**
+ * Claims the index of the next sequence in the fasta file that is long
+ * enough.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param index Set to the index of the next sequence.
+ * @return True while there are still sequences in the buffer, and false
+ *         if the fasta file is read as a stream.
+ */
+int nextSequenceIndex (
+  Fasta * fasta,
+  size_t * index
+) {
+  if (fasta->streaming) {
+    return 0;
+  }
+  return nextIndex (fasta, index);
+}
+
+/**
+ * Retrieves whether the fasta file is read as a stream.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @return True if the fasta file is read as a stream.
+ */
+int isStream (
+  Fasta * fasta
+) {
+  return fasta->streaming;
+}
+
+/**
+ * Retrieves whether the sequences of the fasta file are read with
+ * positional reads.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @return True if the sequences are read with positional reads.
+ */
+int isPositional (
+  Fasta * fasta
+) {
+  return ! fasta->streaming && fasta->descriptor >= 0;
+}
+
+/**
+ * Retrieves whether reading the fasta file as a stream failed.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @return True if the stream could not be read.
+ */
+int hasReadError (
+  Fasta * fasta
+) {
+  return fasta->streaming && ferror (fasta->file);
+}
+
+/**
+ * Retrieves the sequence with an identifier.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param id The identifier of the sequence.
+ * @return The sequence, which should be freed by the caller, or NULL if
+ *         there is no sequence with the identifier or the fasta file is
+ *         read as a stream.
+ */
+Sequence * getSequenceById (
+  Fasta * fasta,
+  char * id
+) {
+  size_t slot;
+  if (fasta->idTable == NULL) {
+    return NULL;
+  }
+  slot = hashIdentifier (id) & (fasta->idTableSize - 1);
+  while (fasta->idTable[slot] != FASTA_EMPTY_SLOT) {
+    if (
+      strcmp (getIdentifierByIndex (fasta, fasta->idTable[slot]), id) == 0
+    ) {
+      return getSequenceByIndex (fasta, fasta->idTable[slot]);
+    }
+    slot = (slot + 1) & (fasta->idTableSize - 1);
+  }
+  return NULL;
+}
+
+/**
+ * Retrieves the identifier of the sequence at an index in the fasta file.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence in the fasta file.
+ * @return The identifier, or NULL if the index is past the last sequence.
+ */
+char * getIdentifierByIndex (
+  Fasta * fasta,
+  size_t index
+) {
+  if (index >= fasta->size) {
+    return NULL;
+  }
+  return fasta->idArena + fasta->idOffsets[index];
+}
+
+/**
+ * Retrieves the number of sequences in this object.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @return The number of sequences longer than the minimum length.
+ */
+size_t numberSequences (
+  Fasta * fasta
+) {
+  size_t i;
+  size_t number = 0;
+  for (i = 0; i < fasta->size; i ++) {
+    if (fasta->lengths[i] >= fasta->minimumLength) {
+      number ++;
+    }
+  }
+  return number;
+}
+
+/**
+ * Retrieves the identifiers of the sequences in this object.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @return The number of sequences longer than length.
+ */
+extern char ** getIdentifiers (
+  Fasta * fasta
+) {
+  size_t i, j;
+  size_t number = numberSequences (fasta);
+  char ** ids = malloc (number * sizeof (char *));
+  j = 0;
+  for (i = 0; i < fasta->size; i ++) {
+    if (fasta->lengths[i] >= fasta->minimumLength) {
+      ids[j] = fasta->idArena + fasta->idOffsets[i];
+      j ++;
+    }
+  }
+  return ids;
+}
+
+/**
+ * Set the minimum sequence length.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param length The minimum sequence length.
+ */
+void setMinimumLength (
+  Fasta * fasta,
+  size_t length
+) {
+  fasta->minimumLength = length;
+}
+
+/**
+ * Set the minimum quality of the nucleotides in a FASTQ file.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param quality The minimum quality.
+ */
+void setMinimumQuality (
+  Fasta * fasta,
+  int quality
+) {
+  fasta->minimumQuality = quality;
+}
+
+/**
+ * Sets the smallest part of a fasta file indexed by each thread.
+ *
+ * @public
+ * @param chunkSize The smallest part of a fasta file indexed by each
+ *        thread.
+ */
+void setFastaChunkSize (
+  size_t chunkSize
+) {
+  fastaChunkSize = chunkSize;
+}
+
+/**
+ * Retrieves part of a sequence from the fasta file.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence in the fasta file.
+ * @param start The position of the first nucleotide of the subsequence.
+ * @param length The length of the subsequence.
+ * @return The subsequence, which should be freed by the caller, or NULL if
+ *         start is past the end of the sequence.
+ */
+char * getSubsequence (
+  Fasta * fasta,
+  size_t index,
+  size_t start,
+  size_t length
+) {
+  char * buffer;
+  size_t first, last, bytes;
+  size_t i, j, column;
+  size_t lineBases, lineWidth;
+  Sequence * seq;
+  if (
+    fasta->streaming || index >= fasta->size ||
+    start > fasta->lengths[index]
+  ) {
+    return NULL;
+  }
+  if (length > fasta->lengths[index] - start) {
+    length = fasta->lengths[index] - start;
+  }
+  lineBases = fasta->lineBases[index];
+  lineWidth = fasta->lineWidths[index];
+  /* Without a regular line length, parse the whole sequence. */
+  if (! fasta->regular || lineBases == 0) {
+    seq = newSequence ();
+    buffer = NULL;
+    if (readSequence (fasta, index, seq)) {
+      buffer = strndup (getSequence (seq) + start, length);
+    }
+    freeSequence (seq);
+    return buffer;
+  }
+  /* Read the lines holding the subsequence in one go. */
+  first = fasta->sequenceOffsets[index] +
+    start / lineBases * lineWidth + start % lineBases;
+  last = fasta->sequenceOffsets[index] +
+    (start + length) / lineBases * lineWidth + (start + length) % lineBases;
+  buffer = malloc ((last - first + 1) * sizeof (char));
+  bytes = readAt (fasta, buffer, last - first, first);
+  /* Drop the line-feed and carriage-return characters at the end of each
+     line. */
+  column = start % lineBases;
+  for (i = 0, j = 0; i < bytes; i ++) {
+    if (column < lineBases) {
+      buffer[j ++] = buffer[i];
+    }
+    column ++;
+    if (column == lineWidth) {
+      column = 0;
+    }
+  }
+  buffer[j] = '\0';
+  return buffer;
+}
+
+/**
+ * Close the file and free the memory reserved for this Fasta object.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta The Fasta object to free.
+ */
+void freeFasta (
+  Fasta * fasta
+) {
+  /* Unmap and close the fasta file. */
+  if (fasta->map != NULL) {
+    munmap (fasta->map, fasta->mapSize);
+  }
+  if (fasta->file != stdin) {
+    fclose (fasta->file);
+  }
+  if (fasta->gzip != NULL) {
+    freeGzip (fasta->gzip);
+  }
+  /* Free the memory allocated for the Fasta object.  The identifiers share
+     a single arena, so the cost does not grow with the number of
+     sequences. */
+  free (fasta->idArena);
+  free (fasta->idOffsets);
+  free (fasta->lengths);
+  free (fasta->offsets);
+  free (fasta->sequenceOffsets);
+  free (fasta->lineBases);
+  free (fasta->lineWidths);
+  free (fasta->idTable);
+  free (fasta->line);
+  free (fasta);
+}
+
+/**
+ * Make room for more sequences in the arrays of this Fasta object.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param capacity The number of sequences to make room for.
+ */
+static void growFasta (
+  Fasta * fasta,
+  size_t capacity
+) {
+  fasta->idOffsets = realloc (fasta->idOffsets, capacity * sizeof (size_t));
+  fasta->lengths = realloc (fasta->lengths, capacity * sizeof (size_t));
+  fasta->offsets = realloc (fasta->offsets, capacity * sizeof (size_t));
+  fasta->sequenceOffsets = realloc (
+    fasta->sequenceOffsets, capacity * sizeof (size_t)
+  );
+  fasta->lineBases = realloc (fasta->lineBases, capacity * sizeof (size_t));
+  fasta->lineWidths = realloc (fasta->lineWidths, capacity * sizeof (size_t));
+}
+
+/**
+ * Store the identifier of a sequence at the end of the identifier arena.
+ *
+ * The arena doubles in size whenever it fills up, so storing the
+ * identifiers takes linear time, and the whole arena is freed at once.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence.
+ * @param id The identifier, which need not be terminated by a null
+ *        character.
+ * @param length The length of the identifier.
+ */
+static void addIdentifier (
+  Fasta * fasta,
+  size_t index,
+  const char * id,
+  size_t length
+) {
+  if (fasta->idArenaSize + length + 1 > fasta->idArenaCapacity) {
+    if (fasta->idArenaCapacity == 0) {
+      fasta->idArenaCapacity = FASTA_INITIAL_CAPACITY;
+    }
+    while (fasta->idArenaSize + length + 1 > fasta->idArenaCapacity) {
+      fasta->idArenaCapacity *= 2;
+    }
+    fasta->idArena = realloc (
+      fasta->idArena, fasta->idArenaCapacity * sizeof (char)
+    );
+  }
+  memcpy (fasta->idArena + fasta->idArenaSize, id, length);
+  fasta->idArena[fasta->idArenaSize + length] = '\0';
+  fasta->idOffsets[index] = fasta->idArenaSize;
+  fasta->idArenaSize += length + 1;
+}
+
+/**
+ * Index the sequences in the fasta file in a single pass.
+ *
+ * The file is read in blocks of FASTA_READ_SIZE bytes, and the identifier,
+ * length, file offsets and line lengths of each sequence are recorded
+ * without building a Sequence object.  Large files that are not compressed
+ * are split into chunks of at least fastaChunkSize bytes, which are
+ * indexed in parallel by indexChunks.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @return The number of sequences found, or 0 if the file can not be
+ *         read.
+ */
+static size_t indexFasta (
+  Fasta * fasta
+) {
+  FastaIndexer indexer = {0};
+  struct stat fileStat;
+  char * buffer;
+  size_t offset = 0;
+  size_t length;
+  size_t chunks = 1;
+  /* Split the file into chunks when there is more than one thread. */
+  if (
+    fasta->gzip == NULL && fstat (fileno (fasta->file), &fileStat) == 0 &&
+    S_ISREG (fileStat.st_mode)
+  ) {
+    chunks = fileStat.st_size / fastaChunkSize;
+#ifdef _OPENMP
+    if (chunks > (size_t)omp_get_max_threads ()) {
+      chunks = omp_get_max_threads ();
+    }
+#else
+    chunks = 1;
+#endif
+    if (chunks > 1) {
+      return indexChunks (fasta, fileStat.st_size, chunks);
+    }
+  }
+  buffer = malloc (FASTA_READ_SIZE * sizeof (char));
+  indexer.lineStart = 1;
+  while ((length = fread (buffer, 1, FASTA_READ_SIZE, fasta->file)) > 0) {
+    indexBlock (fasta, &indexer, buffer, length, offset);
+    offset += length;
+  }
+  finishIndex (fasta, &indexer, offset);
+  free (buffer);
+  /* A file that can not be read to the end, such as a corrupt compressed
+     file, has no sequences. */
+  if (ferror (fasta->file)) {
+    fasta->size = 0;
+  }
+  return fasta->size;
+}
+
+/**
+ * Index the sequences in the fasta file in chunks, one on each thread.
+ *
+ * The file is split into chunks of about the same size, and each chunk is
+ * moved forward to start at a header line, so that no sequence is split
+ * between chunks.  A chunk without a header line is left empty, and its
+ * part of the file is indexed with the chunk before it.  Each thread
+ * indexes its chunk into a Fasta object of its own, and the sequences of
+ * the chunks are then joined in file order, so the index is the same as
+ * the index made by a single pass.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param fileSize The size of the fasta file.
+ * @param chunks The number of chunks.
+ * @return The number of sequences found, or 0 if a chunk can not be read.
+ */
+static size_t indexChunks (
+  Fasta * fasta,
+  size_t fileSize,
+  size_t chunks
+) {
+  Fasta * parts = calloc (chunks, sizeof (Fasta));
+  size_t * bounds = malloc ((chunks + 1) * sizeof (size_t));
+  size_t * starts = malloc ((chunks + 1) * sizeof (size_t));
+  size_t i, j, size;
+  int file = fileno (fasta->file);
+  int errors = 0;
+  /* Split the file evenly, then move the start of each chunk forward to a
+     header line. */
+  for (i = 0; i < chunks; i ++) {
+    bounds[i] = i * (fileSize / chunks);
+  }
+  bounds[chunks] = fileSize;
+  starts[0] = 0;
+  starts[chunks] = fileSize;
+  #pragma omp parallel for
+  for (i = 1; i < chunks; i ++) {
+    starts[i] = findHeader (file, bounds[i], bounds[i + 1]);
+  }
+  /* Index each chunk up to the start of the next chunk with a header. */
+  #pragma omp parallel for schedule (dynamic) reduction (+:errors)
+  for (i = 0; i < chunks; i ++) {
+    FastaIndexer indexer = {0};
+    char * buffer;
+    size_t next, end, offset, length;
+    ssize_t bytes;
+    if (i > 0 && starts[i] == bounds[i + 1]) {
+      continue;
+    }
+    for (next = i + 1; next < chunks; next ++) {
+      if (starts[next] < bounds[next + 1]) {
+        break;
+      }
+    }
+    end = starts[next];
+    buffer = malloc (FASTA_READ_SIZE * sizeof (char));
+    parts[i].regular = 1;
+    indexer.lineStart = 1;
+    for (offset = starts[i]; offset < end; offset += length) {
+      length = end - offset;
+      if (length > FASTA_READ_SIZE) {
+        length = FASTA_READ_SIZE;
+      }
+      bytes = pread (file, buffer, length, offset);
+      if (bytes <= 0) {
+        errors ++;
+        break;
+      }
+      length = bytes;
+      indexBlock (&parts[i], &indexer, buffer, length, offset);
+    }
+    finishIndex (&parts[i], &indexer, offset);
+    free (buffer);
+  }
+  /* Join the sequences of the chunks in file order. */
+  size = 0;
+  for (i = 0; i < chunks; i ++) {
+    size += parts[i].size;
+  }
+  growFasta (fasta, size > 0 ? size : 1);
+  fasta->capacity = size > 0 ? size : 1;
+  fasta->size = 0;
+  for (i = 0; i < chunks; i ++) {
+    for (j = 0; j < parts[i].size; j ++) {
+      addIdentifier (
+        fasta, fasta->size + j, parts[i].idArena + parts[i].idOffsets[j],
+        strlen (parts[i].idArena + parts[i].idOffsets[j])
+      );
+    }
+    memcpy (
+      fasta->lengths + fasta->size, parts[i].lengths,
+      parts[i].size * sizeof (size_t)
+    );
+    memcpy (
+      fasta->offsets + fasta->size, parts[i].offsets,
+      parts[i].size * sizeof (size_t)
+    );
+    memcpy (
+      fasta->sequenceOffsets + fasta->size, parts[i].sequenceOffsets,
+      parts[i].size * sizeof (size_t)
+    );
+    memcpy (
+      fasta->lineBases + fasta->size, parts[i].lineBases,
+      parts[i].size * sizeof (size_t)
+    );
+    memcpy (
+      fasta->lineWidths + fasta->size, parts[i].lineWidths,
+      parts[i].size * sizeof (size_t)
+    );
+    fasta->size += parts[i].size;
+    if (parts[i].size > 0 && ! parts[i].regular) {
+      fasta->regular = 0;
+    }
+    free (parts[i].idArena);
+    free (parts[i].idOffsets);
+    free (parts[i].lengths);
+    free (parts[i].offsets);
+    free (parts[i].sequenceOffsets);
+    free (parts[i].lineBases);
+    free (parts[i].lineWidths);
+  }
+  free (parts);
+  free (bounds);
+  free (starts);
+  /* A chunk that can not be read to its end would leave sequences out of
+     the index. */
+  if (errors > 0) {
+    fasta->size = 0;
+  }
+  return fasta->size;
+}
+
+/**
+ * Find the first header line that starts in part of the fasta file.
+ *
+ * @private
+ * @param file The file descriptor of the fasta file.
+ * @param start The file offset of the start of the part.
+ * @param end The file offset of the end of the part.
+ * @return The file offset of the header line, or end if there is none.
+ */
+static size_t findHeader (
+  int file,
+  size_t start,
+  size_t end
+) {
+  char buffer[4096];
+  char * found;
+  size_t offset, length;
+  ssize_t bytes;
+  /* Look for a line-feed followed by a '>', starting with the character
+     before the part. */
+  for (offset = start - 1; offset + 1 < end; offset += length - 1) {
+    length = end - offset;
+    if (length > sizeof (buffer)) {
+      length = sizeof (buffer);
+    }
+    bytes = pread (file, buffer, length, offset);
+    if (bytes < 2) {
+      break;
+    }
+    length = bytes;
+    found = buffer;
+    while ((found = memchr (found, '\n', buffer + length - 1 - found))) {
+      if (found[1] == '>') {
+        return offset + (found - buffer) + 1;
+      }
+      found ++;
+    }
+  }
+  return end;
+}
+
+/**
+ * Index the sequences in a block of the fasta file.
+ *
+ * The identifier is the first word of the header line, and the length
+ * counts the characters of each sequence line up to the first line-feed
+ * or carriage-return character, the same as parseSequence.  The state of
+ * the indexer carries a header line or sequence line over to the next
+ * block.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param indexer The state of the indexer.
+ * @param buffer The block of the fasta file.
+ * @param length The length of the block.
+ * @param offset The file offset of the block.
+ */
+static void indexBlock (
+  Fasta * fasta,
+  FastaIndexer * indexer,
+  char * buffer,
+  size_t length,
+  size_t offset
+) {
+  char * end;
+  char * cr;
+  size_t i;
+  size_t size = fasta->size;
+  for (i = 0; i < length; i ++) {
+    char c = buffer[i];
+    if (indexer->lineStart) {
+      indexer->lineStart = 0;
+      /* Start a new sequence at each header line. */
+      if (c == '>') {
+        if (size == fasta->capacity) {
+          fasta->capacity = fasta->capacity > 0 ? 2 * fasta->capacity : 1024;
+          growFasta (fasta, fasta->capacity);
+        }
+        fasta->lengths[size] = 0;
+        fasta->offsets[size] = offset + i;
+        fasta->lineBases[size] = 0;
+        fasta->lineWidths[size] = 0;
+        size ++;
+        fasta->size = size;
+        indexer->idLength = 0;
+        indexer->inHeader = 1;
+        indexer->inIdentifier = 1;
+        indexer->lastLine = 0;
+        continue;
+      }
+      /* Only count sequence data that follows a header line. */
+      indexer->counting = size > 0;
+      indexer->lineBases = 0;
+      indexer->lineWidth = 0;
+    }
+    if (indexer->inHeader) {
+      if (c == '\n') {
+        addIdentifier (fasta, size - 1, indexer->id, indexer->idLength);
+        fasta->sequenceOffsets[size - 1] = offset + i + 1;
+        indexer->inHeader = 0;
+        indexer->lineStart = 1;
+      }
+      else if (c == ' ' || c == '\t' || c == '\r') {
+        /* The identifier ends at the first white space after it. */
+        if (indexer->idLength > 0) {
+          indexer->inIdentifier = 0;
+        }
+      }
+      else if (indexer->inIdentifier) {
+        if (indexer->idLength == indexer->idCapacity) {
+          indexer->idCapacity = indexer->idCapacity > 0 ?
+            2 * indexer->idCapacity : 256;
+          indexer->id = realloc (
+            indexer->id, indexer->idCapacity * sizeof (char)
+          );
+        }
+        indexer->id[indexer->idLength ++] = c;
+      }
+      continue;
+    }
+    /* Measure the rest of the sequence line in one step. */
+    end = memchr (buffer + i, '\n', length - i);
+    if (end == NULL) {
+      end = buffer + length;
+    }
+    if (indexer->counting) {
+      cr = memchr (buffer + i, '\r', end - buffer - i);
+      if (cr != NULL) {
+        /* Nothing after a carriage-return is part of the sequence. */
+        indexer->lineBases += cr - buffer - i;
+        indexer->counting = 0;
+      }
+      else {
+        indexer->lineBases += end - buffer - i;
+      }
+    }
+    indexer->lineWidth += end - buffer - i;
+    i = end - buffer;
+    if (i < length) {
+      indexer->lineStart = 1;
+      if (size > 0) {
+        indexLine (
+          fasta, size - 1, indexer->lineBases, indexer->lineWidth + 1,
+          &indexer->lastLine
+        );
+      }
+    }
+  }
+}
+
+/**
+ * Finish the last sequence at the end of the indexed part of the file.
+ *
+ * A header line or sequence line without a line-feed at the end of the
+ * file is added to the index, and the memory used by the indexer is freed.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param indexer The state of the indexer.
+ * @param offset The file offset of the end of the indexed part.
+ */
+static void finishIndex (
+  Fasta * fasta,
+  FastaIndexer * indexer,
+  size_t offset
+) {
+  if (indexer->inHeader) {
+    addIdentifier (fasta, fasta->size - 1, indexer->id, indexer->idLength);
+    fasta->sequenceOffsets[fasta->size - 1] = offset;
+  }
+  else if (! indexer->lineStart && fasta->size > 0) {
+    indexLine (
+      fasta, fasta->size - 1, indexer->lineBases, indexer->lineWidth,
+      &indexer->lastLine
+    );
+  }
+  free (indexer->id);
+}
+
+/**
+ * Add a line of sequence data to the index of a sequence.
+ *
+ * The first line sets the line length of the sequence.  The lines after it
+ * must be the same length, except for the last lines, which may be
+ * shorter.  Otherwise the sequences in this Fasta object are marked as not
+ * regular.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence.
+ * @param bases The number of nucleotides on the line.
+ * @param width The number of bytes on the line.
+ * @param lastLine Set once a line shorter than the first line is found.
+ */
+static void indexLine (
+  Fasta * fasta,
+  size_t index,
+  size_t bases,
+  size_t width,
+  int * lastLine
+) {
+  fasta->lengths[index] += bases;
+  if (fasta->lineWidths[index] == 0) {
+    fasta->lineBases[index] = bases;
+    fasta->lineWidths[index] = width;
+    return;
+  }
+  if (
+    (*lastLine && bases > 0) || bases > fasta->lineBases[index] ||
+    width > fasta->lineWidths[index]
+  ) {
+    fasta->regular = 0;
+  }
+  else if (width < fasta->lineWidths[index]) {
+    *lastLine = 1;
+  }
+}
+
+/**
+ * Read the index at the start of a UCSC .2bit file.
+ *
+ * The header holds the signature, which also gives the byte order of the
+ * file, the version, and the number of sequences.  The index that follows
+ * has the name of each sequence and the file offset of its record, 32 bits
+ * long in version 0 files and 64 bits long in version 1 files.  The length
+ * of each sequence is the first word of its record.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @return The number of sequences found, or 0 if the file is not a .2bit
+ *         file.
+ */
+static size_t readTwoBitIndex (
+  Fasta * fasta
+) {
+  uint32_t header[4];
+  uint32_t words[2];
+  unsigned char nameLength;
+  char name[256];
+  size_t offset = sizeof (uint32_t);
+  size_t i;
+  fasta->twoBit = 0;
+  fasta->swapped = 0;
+  if (readAt (fasta, header, sizeof (uint32_t), 0) != sizeof (uint32_t)) {
+    fseek (fasta->file, 0, SEEK_SET);
+    return 0;
+  }
+  if (header[0] != FASTA_TWOBIT_SIGNATURE) {
+    fasta->swapped = __builtin_bswap32 (header[0]) == FASTA_TWOBIT_SIGNATURE;
+    if (! fasta->swapped) {
+      fseek (fasta->file, 0, SEEK_SET);
+      return 0;
+    }
+  }
+  fasta->twoBit = 1;
+  fasta->regular = 0;
+  if (! readTwoBitWords (fasta, header + 1, 3, &offset) || header[1] > 1) {
+    return 0;
+  }
+  growFasta (fasta, header[2]);
+  for (i = 0; i < header[2]; i ++) {
+    /* Read the name and record offset of the sequence. */
+    if (readAt (fasta, &nameLength, 1, offset) != 1) {
+      break;
+    }
+    offset ++;
+    if (readAt (fasta, name, nameLength, offset) != nameLength) {
+      break;
+    }
+    offset += nameLength;
+    if (! readTwoBitWords (fasta, words, header[1] == 1 ? 2 : 1, &offset)) {
+      break;
+    }
+    addIdentifier (fasta, i, name, nameLength);
+    fasta->offsets[i] = words[0];
+    if (header[1] == 1) {
+      fasta->offsets[i] = fasta->swapped ?
+        (uint64_t)words[0] << 32 | words[1] :
+        (uint64_t)words[1] << 32 | words[0];
+    }
+    fasta->sequenceOffsets[i] = FASTA_UNKNOWN_OFFSET;
+    fasta->lineBases[i] = 0;
+    fasta->lineWidths[i] = 0;
+  }
+  fasta->size = i;
+  /* Read the length of each sequence from its record. */
+  for (i = 0; i < fasta->size; i ++) {
+    offset = fasta->offsets[i];
+    fasta->lengths[i] = readTwoBitWords (fasta, words, 1, &offset) ?
+      words[0] : 0;
+  }
+  return fasta->size;
+}
+
+/**
+ * Read words from a UCSC .2bit file, in the byte order of the file.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param words The words to read.
+ * @param number The number of words to read.
+ * @param offset The file offset of the words, moved past them.
+ * @return True if every word was read.
+ */
+static int readTwoBitWords (
+  Fasta * fasta,
+  uint32_t * words,
+  size_t number,
+  size_t * offset
 ) {
-  Fasta * fasta = malloc (sizeof (Fasta));
   size_t i;
-  /* Open the fasta file with read access. */
-  fasta->file = fopen (fileName, "r");
-  /* Verify that the fasta file is open. */
-  if (fasta->file == NULL) {
-    free (fasta);
-    return NULL;
+  size_t bytes = number * sizeof (uint32_t);
+  if (readAt (fasta, words, bytes, *offset) != bytes) {
+    return 0;
   }
-  /* Count the number of sequences in this fasta file. */
-  char * buffer = malloc (LINE_MAX * sizeof (char));
-  fasta->size = 0;
-  while (fgets (buffer, LINE_MAX, fasta->file) != NULL) {
-    if (buffer[0] == '>') {
-      fasta->size ++;
+  *offset += bytes;
+  if (fasta->swapped) {
+    for (i = 0; i < number; i ++) {
+      words[i] = __builtin_bswap32 (words[i]);
     }
   }
-  free (buffer);
-  /* Verify that the fasta has at least one sequence. */
-  if (fasta->size == 0) {
-    free (fasta);
+  return 1;
+}
+
+/**
+ * Parse a sequence from a UCSC .2bit file into packed nucleotides.
+ *
+ * The record of the sequence holds its length, the blocks of N, the
+ * masked blocks, and the nucleotides packed four to a byte.  The .2bit
+ * file packs T, C, A and G as 0, 1, 2 and 3 with the first nucleotide in
+ * the highest bits, so each byte is translated with a table into the
+ * layout of encodeNucleotides.  The nucleotides are never unpacked into
+ * characters.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence.
+ * @param seq The sequence object to fill.
+ * @return True if the sequence was parsed, false if the sequence record is
+ *         cut short.
+ */
+static int parseTwoBit (
+  Fasta * fasta,
+  size_t index,
+  Sequence * seq
+) {
+  static const uint8_t codes[4] = {3, 1, 0, 2};
+  uint8_t table[256];
+  uint32_t words[2];
+  PackedNucleotides * packed;
+  size_t offset = fasta->offsets[index];
+  size_t bytes, i;
+  int complete;
+  /* Read the length, the blocks of N and the masked blocks of the
+     sequence, and skip the reserved word. */
+  if (! readTwoBitWords (fasta, words, 1, &offset)) {
+    return 0;
+  }
+  packed = malloc (sizeof (PackedNucleotides));
+  packed->length = words[0];
+  packed->codes = NULL;
+  packed->ambiguous = readTwoBitBlocks (
+    fasta, 'N', &packed->numAmbiguous, &offset
+  );
+  packed->masked = readTwoBitBlocks (fasta, 0, &packed->numMasked, &offset);
+  complete = packed->ambiguous != NULL && packed->masked != NULL &&
+    readTwoBitWords (fasta, words, 1, &offset);
+  /* Read the packed nucleotides. */
+  bytes = (packed->length + 3) / 4;
+  packed->codes = malloc ((bytes + 1) * sizeof (uint8_t));
+  if (! complete || readAt (fasta, packed->codes, bytes, offset) != bytes) {
+    freePackedNucleotides (packed);
+    return 0;
+  }
+  packed->codes[bytes] = 0;
+  /* Translate the codes of each byte, and put the first nucleotide in the
+     lowest bits. */
+  for (i = 0; i < 256; i ++) {
+    table[i] = codes[i >> 6] | codes[(i >> 4) & 3] << 2 |
+      codes[(i >> 2) & 3] << 4 | codes[i & 3] << 6;
+  }
+  for (i = 0; i < bytes; i ++) {
+    packed->codes[i] = table[packed->codes[i]];
+  }
+  setHeader (seq, getIdentifierByIndex (fasta, index));
+  adoptPackedSequence (seq, packed);
+  return 1;
+}
+
+/**
+ * Read a list of blocks from the record of a sequence in a UCSC .2bit
+ * file, the number of blocks followed by their starts and their sizes.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param base The character of the runs.
+ * @param number Set to the number of blocks.
+ * @param offset The file offset of the list, moved past it.
+ * @return The blocks as runs, or NULL if the list is cut short.
+ */
+static PackedRun * readTwoBitBlocks (
+  Fasta * fasta,
+  char base,
+  size_t * number,
+  size_t * offset
+) {
+  PackedRun * runs;
+  uint32_t * words;
+  uint32_t count;
+  size_t i;
+  *number = 0;
+  if (! readTwoBitWords (fasta, &count, 1, offset)) {
     return NULL;
   }
-  /* Grab the identifiers and the file offset for each sequence. */
-  fasta->ids = malloc (fasta->size * sizeof (char *));
-  fasta->lengths = malloc (fasta->size * sizeof (size_t));
-  fasta->offsets = malloc (fasta->size * sizeof (size_t));
-  fseek (fasta->file, 0, SEEK_SET);
-  for (i = 0; i < fasta->size; i ++) {
-    size_t offset = ftell (fasta->file);
-    Sequence * seq = parseSequence (fasta->file);
-    fasta->ids[i] = strdup (getIdentifier (seq));
-    fasta->lengths[i] = getSequenceLength (seq);
-    fasta->offsets[i] = offset;
-    freeSequence (seq);
+  words = malloc ((2 * (size_t)count + 1) * sizeof (uint32_t));
+  if (! readTwoBitWords (fasta, words, 2 * (size_t)count, offset)) {
+    free (words);
+    return NULL;
   }
-  fseek (fasta->file, 0, SEEK_SET);
-  /* Default to a minimum sequence length of 1. */
-  fasta->minimumLength = 1;
-  /* Set the current sequence as the first found in the file. */
-  fasta->current = 0;
-  return fasta;
+  runs = malloc ((count + 1) * sizeof (PackedRun));
+  for (i = 0; i < count; i ++) {
+    runs[i].start = words[i];
+    runs[i].length = words[count + i];
+    runs[i].base = base;
+  }
+  free (words);
+  *number = count;
+  return runs;
 }
 
 /**
- * Retrieves the next sequence from the fasta file.
+ * Read the index of the sequences from an index file.
  *
- * @memberof Fasta
- * @public
+ * The index file holds a line for each sequence with five tab separated
+ * columns: the identifier, the length, the file offset of the sequence
+ * data, the number of nucleotides on each line and the number of bytes on
+ * each line.  The index file is only used if it was written after the
+ * fasta file was last changed, every sequence it describes fits in the
+ * fasta file, and the last sequence ends at the end of the fasta file.
+ *
+ * @private
  * @param fasta This Fasta object.
- * @param seq The sequence to be returned.
- * @return True while there are still sequences in the buffer.
+ * @param indexName The name of the index file.
+ * @param fileStat The status of the fasta file.
+ * @return The number of sequences found, or 0 if the index file is missing
+ *         or out of date.
  */
-int nextSequence (
+static size_t readFastaIndex (
   Fasta * fasta,
-  Sequence ** seq
+  char * indexName,
+  struct stat * fileStat
 ) {
-  /* Skip sequences that are not long enough. */
-  while (
-    fasta->current < fasta->size &&
-    fasta->lengths[fasta->current] < fasta->minimumLength
+  struct stat indexStat;
+  FILE * file;
+  char * line = NULL;
+  char * field;
+  char * end;
+  size_t lineSize = 0;
+  size_t capacity = 0;
+  size_t size = 0;
+  size_t fileSize = fileStat->st_size;
+  size_t values[4];
+  size_t span, j;
+  size_t last = 0;
+  size_t lastBreak = 0;
+  int valid = 1;
+  if (stat (indexName, &indexStat) != 0) {
+    return 0;
+  }
+  /* An index file written in the same instant as the fasta file was
+     changed may be out of date. */
+  if (
+    indexStat.st_mtim.tv_sec < fileStat->st_mtim.tv_sec || (
+      indexStat.st_mtim.tv_sec == fileStat->st_mtim.tv_sec &&
+      indexStat.st_mtim.tv_nsec <= fileStat->st_mtim.tv_nsec
+    )
   ) {
-    fasta->current ++;
+    return 0;
+  }
+  file = fopen (indexName, "r");
+  if (file == NULL) {
+    return 0;
+  }
+  while (valid && getline (&line, &lineSize, file) >= 0) {
+    chomp (line);
+    /* Split the identifier from the numeric columns. */
+    field = strchr (line, '\t');
+    if (field == NULL) {
+      valid = 0;
+      break;
+    }
+    *field = '\0';
+    for (j = 0; j < 4; j ++) {
+      values[j] = strtoull (field + 1, &end, 10);
+      if (end == field + 1 || (*end != '\t' && *end != '\0')) {
+        valid = 0;
+      }
+      field = end;
+    }
+    /* Make sure the sequence fits in the fasta file. */
+    last = values[1];
+    lastBreak = 0;
+    if (valid && values[0] > 0) {
+      if (values[2] == 0 || values[3] < values[2]) {
+        valid = 0;
+        break;
+      }
+      span = values[0] / values[2] * values[3] + values[0] % values[2];
+      if (values[0] % values[2] == 0) {
+        span -= values[3] - values[2];
+      }
+      if (values[1] + span > fileSize) {
+        valid = 0;
+      }
+      last = values[1] + span;
+      lastBreak = values[3] - values[2];
+    }
+    if (! valid) {
+      break;
+    }
+    if (size == capacity) {
+      capacity = capacity > 0 ? 2 * capacity : 1024;
+      growFasta (fasta, capacity);
+    }
+    addIdentifier (fasta, size, line, strlen (line));
+    fasta->lengths[size] = values[0];
+    fasta->sequenceOffsets[size] = values[1];
+    fasta->lineBases[size] = values[2];
+    fasta->lineWidths[size] = values[3];
+    /* The header lines are found when they are needed. */
+    fasta->offsets[size] = FASTA_UNKNOWN_OFFSET;
+    size ++;
+  }
+  free (line);
+  fclose (file);
+  /* A truncated index file leaves sequences out, so the last sequence,
+     with or without the line break after it, must end the fasta file. */
+  if (size > 0 && last != fileSize && last + lastBreak != fileSize) {
+    valid = 0;
+  }
+  if (! valid) {
+    fasta->idArenaSize = 0;
+    return 0;
+  }
+  return size;
+}
+
+/**
+ * Write the index of the sequences to an index file.
+ *
+ * The index is written to a temporary file in the same directory, which
+ * is renamed over the index file once it is complete, so a crash or
+ * another process indexing the same fasta file never leaves a truncated
+ * index file behind.  The index file is left out if it can not be
+ * written, such as in a read only directory.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param indexName The name of the index file.
+ */
+static void writeFastaIndex (
+  Fasta * fasta,
+  char * indexName
+) {
+  static mode_t mask;
+  static int maskRead = 0;
+  char * tempName;
+  FILE * file;
+  size_t i;
+  int descriptor;
+  int error = 0;
+  tempName = malloc ((strlen (indexName) + 8) * sizeof (char));
+  sprintf (tempName, "%s.XXXXXX", indexName);
+  descriptor = mkstemp (tempName);
+  if (descriptor < 0) {
+    free (tempName);
+    return;
+  }
+  /* Create the index file with the process umask, as fopen would.  The
+     umask can only be read by setting it, so read it once. */
+  #pragma omp critical (fastaIndexMask)
+  {
+    if (! maskRead) {
+      mask = umask (0);
+      umask (mask);
+      maskRead = 1;
+    }
+  }
+  fchmod (descriptor, 0666 & ~mask);
+  file = fdopen (descriptor, "w");
+  if (file == NULL) {
+    close (descriptor);
+    remove (tempName);
+    free (tempName);
+    return;
   }
+  for (i = 0; i < fasta->size && ! error; i ++) {
+    error = fprintf (
+      file, "%s\t%zu\t%zu\t%zu\t%zu\n", fasta->idArena + fasta->idOffsets[i],
+      fasta->lengths[i], fasta->sequenceOffsets[i], fasta->lineBases[i],
+      fasta->lineWidths[i]
+    ) < 0;
+  }
+  if (fclose (file) != 0 || error || rename (tempName, indexName) != 0) {
+    remove (tempName);
+  }
+  free (tempName);
+}
+
+/**
+ * Find the index of the next sequence that is long enough.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param index Set to the index of the next sequence.
+ * @return True while there are still sequences in the buffer.
+ */
+static int nextIndex (
+  Fasta * fasta,
+  size_t * index
+) {
+  size_t current;
+  /* Claim the current sequence, skipping sequences that are not long
+     enough.  Each claim moves the cursor atomically, so several threads
+     can take sequences at once without locking. */
+  do {
+    #pragma omp atomic capture
+    current = fasta->current ++;
+  } while (
+    current < fasta->size && fasta->lengths[current] < fasta->minimumLength
+  );
   /* Make sure there are sequences available. */
-  if (fasta->size <= fasta->current) {
+  if (fasta->size <= current) {
+    /* Leave the cursor at the end. */
+    #pragma omp atomic write
+    fasta->current = fasta->size;
     return 0;
   }
-  /* Seek to the location of the current sequence in the file. */
-  fseek (fasta->file, fasta->offsets[fasta->current], SEEK_SET);
-  /* Parse the current sequence. */
-  *seq = parseSequence (fasta->file);
-  /* Increment the current sequence. */
-  fasta->current ++;
+  *index = current;
   return 1;
 }
 
 /**
- * Retrieves the number of sequences in this object.
+ * Read and parse a sequence from the fasta file.
  *
- * @memberof Fasta
- * @public
+ * The header line and the sequence data are read with readAt into the
+ * buffers of the sequence object, and the line breaks are dropped in
+ * place.  Nothing is shared but the index, so several threads can read
+ * sequences at once, each into its own sequence object.
+ *
+ * @private
  * @param fasta This Fasta object.
- * @return The number of sequences longer than the minimum length.
+ * @param index The index of the sequence.
+ * @param seq The sequence object to fill.
+ * @return True if the sequence was parsed, false if it could not be read
+ *         in full.
  */
-size_t numberSequences (
-  Fasta * fasta
+static int readSequence (
+  Fasta * fasta,
+  size_t index,
+  Sequence * seq
 ) {
-  size_t i;
-  size_t number = 0;
-  for (i = 0; i < fasta->size; i ++) {
-    if (fasta->lengths[i] >= fasta->minimumLength) {
-      number ++;
+  size_t length = fasta->lengths[index];
+  size_t offset = fasta->sequenceOffsets[index];
+  size_t start, bytes, position, i;
+  char * buffer;
+  char * raw;
+  if (fasta->twoBit) {
+    return parseTwoBit (fasta, index, seq);
+  }
+  /* Read the header line, which ends where the sequence data starts. */
+  start = headerOffset (fasta, index);
+  buffer = reserveSequence (seq, offset - start);
+  bytes = readAt (fasta, buffer, offset - start, start);
+  if (bytes < offset - start) {
+    return 0;
+  }
+  buffer[bytes] = '\0';
+  if (buffer[0] != '>') {
+    printf ("Not a fasta formated sequence.\n%s\n", buffer);
+    return 0;
+  }
+  chomp (buffer);
+  setHeader (seq, buffer + 1);
+  /* Read the sequence data, dropping the line breaks in place.  The bytes
+     holding the nucleotides are known from the line length, otherwise
+     room is left for a line break every 16 nucleotides and the rest is
+     read on the next pass. */
+  position = 0;
+  while (position < length) {
+    bytes = length - position;
+    if (position == 0 && fasta->lineBases[index] > 0) {
+      bytes = (length - 1) / fasta->lineBases[index] *
+        fasta->lineWidths[index] + (length - 1) % fasta->lineBases[index] + 1;
+    }
+    else {
+      bytes += bytes / 16 + 2;
+    }
+    buffer = reserveSequence (seq, position + bytes);
+    raw = buffer + position;
+    bytes = readAt (fasta, raw, bytes, offset);
+    if (bytes == 0) {
+      break;
+    }
+    offset += bytes;
+    for (i = 0; i < bytes && position < length; i ++) {
+      if (raw[i] != '\n' && raw[i] != '\r') {
+        buffer[position] = raw[i];
+        position ++;
+      }
     }
   }
-  return number;
+  setSequenceLength (seq, position);
+  /* A failed or short read leaves the sequence cut short. */
+  return position == length;
 }
 
 /**
- * Retrieves the identifiers of the sequences in this object.
+ * Fill a sequence object with the sequence at an index in the fasta file.
  *
- * @memberof Fasta
- * @public
+ * @private
  * @param fasta This Fasta object.
- * @return The number of sequences longer than length.
+ * @param index The index of the sequence.
+ * @param seq The sequence object to fill.
+ * @return True if the sequence was found.
  */
-extern char ** getIdentifiers (
+static int fillSequence (
+  Fasta * fasta,
+  size_t index,
+  Sequence * seq
+) {
+  if (fasta->map == NULL) {
+    return readSequence (fasta, index, seq);
+  }
+  /* Point the sequence at its sequence data in the mapped file. */
+  setHeader (seq, getIdentifierByIndex (fasta, index));
+  viewSequence (
+    seq, fasta->map + fasta->sequenceOffsets[index], fasta->lengths[index],
+    fasta->lineBases[index], fasta->lineWidths[index]
+  );
+  return 1;
+}
+
+/**
+ * Hash a sequence identifier with the 64-bit FNV-1a hash.
+ *
+ * @private
+ * @param id The identifier.
+ * @return The hash of the identifier.
+ */
+static uint64_t hashIdentifier (
+  char * id
+) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (; *id != '\0'; id ++) {
+    hash ^= (unsigned char)*id;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/**
+ * Build the hash table of identifiers used by getSequenceById.
+ *
+ * The table is an open addressing table of sequence indices, kept at most
+ * half full.  The table is never changed afterwards, so it can be read by
+ * several threads at once.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ */
+static void buildIdTable (
   Fasta * fasta
 ) {
-  size_t i, j;
-  size_t number = numberSequences (fasta);
-  char ** ids = malloc (number * sizeof (char *));
-  j = 0;
+  size_t i, slot;
+  char * id;
+  fasta->idTableSize = 16;
+  while (fasta->idTableSize < 2 * fasta->size) {
+    fasta->idTableSize *= 2;
+  }
+  fasta->idTable = malloc (fasta->idTableSize * sizeof (size_t));
+  for (i = 0; i < fasta->idTableSize; i ++) {
+    fasta->idTable[i] = FASTA_EMPTY_SLOT;
+  }
   for (i = 0; i < fasta->size; i ++) {
-    if (fasta->lengths[i] >= fasta->minimumLength) {
-      ids[j] = fasta->ids[i];
-      j ++;
+    id = fasta->idArena + fasta->idOffsets[i];
+    slot = hashIdentifier (id) & (fasta->idTableSize - 1);
+    while (
+      fasta->idTable[slot] != FASTA_EMPTY_SLOT &&
+      strcmp (getIdentifierByIndex (fasta, fasta->idTable[slot]), id) != 0
+    ) {
+      slot = (slot + 1) & (fasta->idTableSize - 1);
+    }
+    /* Keep the first of the sequences that share an identifier. */
+    if (fasta->idTable[slot] == FASTA_EMPTY_SLOT) {
+      fasta->idTable[slot] = i;
     }
   }
-  return ids;
 }
 
 /**
- * Set the minimum sequence length.
+ * Parse the next sequence from a fasta file read as a stream.
  *
- * @memberof Fasta
- * @public
+ * Sequences shorter than the minimum length are parsed and thrown away.
+ * The identifier and length of each sequence returned are added to the
+ * arrays of this Fasta object.
+ *
+ * @private
  * @param fasta This Fasta object.
- * @param length The minimum sequence length.
+ * @param seq The sequence object to fill.
+ * @return True while there are still sequences in the stream.
  */
-void setMinimumLength (
+static int nextStreamSequence (
   Fasta * fasta,
-  size_t length
+  Sequence * seq
 ) {
-  fasta->minimumLength = length;
+  int c;
+  int parsed;
+  while ((c = getc (fasta->file)) != EOF) {
+    ungetc (c, fasta->file);
+    if (fasta->fastq) {
+      parsed = parseFastq (fasta, seq);
+    }
+    else {
+      parsed = parseSequence (fasta, seq);
+    }
+    /* A sequence cut short by a read error is not returned. */
+    if (! parsed || ferror (fasta->file)) {
+      return 0;
+    }
+    /* Skip sequences that are not long enough. */
+    if (getSequenceLength (seq) < fasta->minimumLength) {
+      continue;
+    }
+    /* Keep the identifier and length of the sequence. */
+    if (fasta->size == fasta->capacity) {
+      fasta->capacity = fasta->capacity > 0 ? 2 * fasta->capacity : 1024;
+      growFasta (fasta, fasta->capacity);
+    }
+    addIdentifier (
+      fasta, fasta->size, getIdentifier (seq), getIdentifierLength (seq)
+    );
+    fasta->lengths[fasta->size] = getSequenceLength (seq);
+    fasta->offsets[fasta->size] = FASTA_UNKNOWN_OFFSET;
+    fasta->sequenceOffsets[fasta->size] = FASTA_UNKNOWN_OFFSET;
+    fasta->lineBases[fasta->size] = 0;
+    fasta->lineWidths[fasta->size] = 0;
+    fasta->size ++;
+    fasta->current = fasta->size;
+    return 1;
+  }
+  return 0;
 }
 
 /**
- * Close the file and free the memory reserved for this Fasta object.
+ * Find the file offset of the header line of a sequence.
  *
- * @memberof Fasta
- * @public
- * @param fasta The Fasta object to free.
+ * Sequences read from an index file only know the offset of their
+ * sequence data, so the file is read backwards from there to the start of
+ * the header line.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence.
+ * @return The file offset of the header line.
  */
-void freeFasta (
-  Fasta * fasta
+static size_t headerOffset (
+  Fasta * fasta,
+  size_t index
 ) {
-  size_t i;
-  /* Close the fasta file. */
-  fclose (fasta->file);
-  /* Free the memory allocated for the Fasta object. */
-  for (i = 0; i < fasta->size; i ++) {
-    free (fasta->ids[i]);
+  char buffer[4096];
+  size_t end, start, length;
+  size_t offset;
+  #pragma omp atomic read
+  offset = fasta->offsets[index];
+  if (offset != FASTA_UNKNOWN_OFFSET) {
+    return offset;
   }
-  free (fasta->ids);
-  free (fasta->lengths);
-  free (fasta->offsets);
-  free (fasta);
+  /* Skip the line-feed at the end of the header line. */
+  end = fasta->sequenceOffsets[index] > 0 ?
+    fasta->sequenceOffsets[index] - 1 : 0;
+  offset = 0;
+  while (end > 0) {
+    start = end > sizeof (buffer) ? end - sizeof (buffer) : 0;
+    length = readAt (fasta, buffer, end - start, start);
+    while (length > 0 && buffer[length - 1] != '\n') {
+      length --;
+    }
+    if (length > 0) {
+      offset = start + length;
+      break;
+    }
+    end = start;
+  }
+  /* Threads that find the offset at the same time store the same value. */
+  #pragma omp atomic write
+  fasta->offsets[index] = offset;
+  return offset;
 }
 
 /**
- * Parse a sequence from the fasta file.
+ * Read part of the fasta file at a file offset.
+ *
+ * Files that are not compressed are read with pread, which leaves the
+ * file position alone, so several threads can read at once without
+ * locking.  Compressed files are read from the decompressed stream, one
+ * thread at a time.
  *
  * @private
- * @param file The file with the sequence to parse.
- * @return The sequence.
+ * @param fasta This Fasta object.
+ * @param buffer The buffer to read into.
+ * @param length The number of bytes to read.
+ * @param offset The file offset of the first byte.
+ * @return The number of bytes read, less than length at the end of the
+ *         file.
  */
-static Sequence * parseSequence (
-  FILE * file
+static size_t readAt (
+  Fasta * fasta,
+  void * buffer,
+  size_t length,
+  size_t offset
+) {
+  size_t total = 0;
+  ssize_t bytes;
+  if (fasta->descriptor < 0) {
+    #pragma omp critical (fastaFile)
+    {
+      fseek (fasta->file, offset, SEEK_SET);
+      total = fread (buffer, 1, length, fasta->file);
+    }
+    return total;
+  }
+  while (total < length) {
+    bytes = pread (
+      fasta->descriptor, (char *)buffer + total, length - total,
+      offset + total
+    );
+    if (bytes <= 0) {
+      break;
+    }
+    total += bytes;
+  }
+  return total;
+}
+
+/**
+ * Parse a sequence from a fasta file read as a stream.
+ *
+ * Each line of sequence data is appended at the end of the buffer of the
+ * sequence object (see reserveSequence), which at least doubles in size
+ * whenever it fills up, so long sequences are parsed in linear time.  The
+ * lines are read into the line buffer of this Fasta object, so a sequence
+ * object that is filled over and over allocates no memory once its
+ * buffers have grown to fit.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param seq The sequence object to fill.
+ * @return True if a sequence was parsed.
+ */
+static int parseSequence (
+  Fasta * fasta,
+  Sequence * seq
 ) {
-  char * buffer = malloc (LINE_MAX * sizeof (char));
-  char * seqBuffer = malloc (FASTA_BUFFER_SIZE * sizeof (char));
-  Sequence * seq = newSequence();
+  FILE * file = fasta->file;
+  ssize_t lineLength;
+  size_t position = 0;
+  char * seqBuffer;
+  int c;
   /* Make sure there is a sequence at the current location. */
-  if (fgets (buffer, LINE_MAX, file) == NULL) {
+  if (getline (&fasta->line, &fasta->lineSize, file) < 0) {
     printf ("No sequence found.\n");
     return 0;
   }
-  if (buffer[0] != '>') {
-    printf ("Not a fasta formated sequence.\n%s\n", buffer);
+  if (fasta->line[0] != '>') {
+    printf ("Not a fasta formated sequence.\n%s\n", fasta->line);
     return 0;
   }
-  /* Remove line-feed and carriage-return characters from the buffer. */
-  chomp (buffer);
-  /* Tokenize the buffer. */
-  char * token = strdup (buffer + 1);
-  /* Grab the sequence identifier from the fasta buffer. */
-  char * id = strtok (token, " \t\r\n");
-  setIdentifier (seq, id);
-  /* Grab the sequence description from the fasta buffer. */
-  char * desc = strdup(buffer + strlen (id) + 2);
-  setDescription (seq, desc);
-  /* Initialize the sequence buffer. */
-  seqBuffer[0] = '\0';
+  /* Remove line-feed and carriage-return characters from the header. */
+  chomp (fasta->line);
+  setHeader (seq, fasta->line + 1);
   /* Grab the sequence data. */
-  while (fgets (buffer, LINE_MAX, file)) {
-    /* Stop when the next sequence is found. */
-    if (buffer[0] == '>') {
-      fseek (file, ftell (file) - strlen (buffer), SEEK_SET);
+  seqBuffer = reserveSequence (seq, FASTA_INITIAL_CAPACITY - 1);
+  while ((c = getc (file)) != EOF) {
+    /* Stop when the next sequence is found, leaving its header line to be
+       read next.  Only the first character of the line is put back, so
+       the file does not need to seek. */
+    ungetc (c, file);
+    if (c == '>') {
+      break;
+    }
+    lineLength = getline (&fasta->line, &fasta->lineSize, file);
+    if (lineLength < 0) {
       break;
     }
-    /* Remove line-feed and carriage-return characters from the buffer. */
-    chomp (buffer);
-    /* Store the sequence data. */
-    seqBuffer = strcat (seqBuffer, buffer);
+    /* Remove line-feed and carriage-return characters from the line. */
+    lineLength = strcspn (fasta->line, "\r\n");
+    /* Store the sequence data at the end of the sequence buffer. */
+    seqBuffer = reserveSequence (seq, position + lineLength);
+    memcpy (seqBuffer + position, fasta->line, lineLength);
+    position += lineLength;
   }
-  /* Grab the sequence from the sequence buffer. */
-  setSequence (seq, seqBuffer);
-  /* Free reserved memory. */
-  free (buffer);
-  free (seqBuffer);
-  free (token);
-  free (desc);
-  return seq;
+  setSequenceLength (seq, position);
+  return 1;
+}
+
+/**
+ * Parse a sequence from a FASTQ file.
+ *
+ * The sequence lines run up to the '+' line, and are followed by quality
+ * lines holding a quality value for each nucleotide.  The nucleotides with
+ * a quality below the minimum are replaced with FASTA_MASK_CHARACTER as
+ * the quality lines are read, so the masked nucleotides are skipped or
+ * spread by the counting kernels like any other N.
+ *
+ * @private
+ * @param fasta This Fasta object.
+ * @param seq The sequence object to fill.
+ * @return True if a sequence was parsed.
+ */
+static int parseFastq (
+  Fasta * fasta,
+  Sequence * seq
+) {
+  FILE * file = fasta->file;
+  int minimumQuality = fasta->minimumQuality;
+  ssize_t lineLength;
+  size_t position = 0;
+  size_t quality = 0;
+  size_t i;
+  char * seqBuffer;
+  /* Make sure there is a sequence at the current location. */
+  if (getline (&fasta->line, &fasta->lineSize, file) < 0) {
+    printf ("No sequence found.\n");
+    return 0;
+  }
+  if (fasta->line[0] != '@') {
+    printf ("Not a fastq formated sequence.\n%s\n", fasta->line);
+    return 0;
+  }
+  chomp (fasta->line);
+  setHeader (seq, fasta->line + 1);
+  /* Grab the sequence data, up to the '+' line. */
+  seqBuffer = reserveSequence (seq, FASTA_INITIAL_CAPACITY - 1);
+  while (
+    (lineLength = getline (&fasta->line, &fasta->lineSize, file)) >= 0 &&
+    fasta->line[0] != '+'
+  ) {
+    lineLength = strcspn (fasta->line, "\r\n");
+    seqBuffer = reserveSequence (seq, position + lineLength);
+    memcpy (seqBuffer + position, fasta->line, lineLength);
+    position += lineLength;
+  }
+  /* Grab the quality values, at least one line of them, and mask the
+     nucleotides with a low quality. */
+  do {
+    if (getline (&fasta->line, &fasta->lineSize, file) < 0) {
+      break;
+    }
+    lineLength = strcspn (fasta->line, "\r\n");
+    if (minimumQuality > 0) {
+      for (i = 0; i < (size_t)lineLength && quality + i < position; i ++) {
+        if (fasta->line[i] < FASTA_QUALITY_OFFSET + minimumQuality) {
+          seqBuffer[quality + i] = FASTA_MASK_CHARACTER;
+        }
+      }
+    }
+    quality += lineLength;
+  } while (quality < position);
+  setSequenceLength (seq, position);
+  return 1;
 }
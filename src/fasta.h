@@ -36,18 +36,71 @@
 #define _OLIGO_FASTA_H
 
 #include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
+#include "gzip.h"
 #include "sequence.h"
 #include "tools.h"
 
 /**
- * @def FASTA_BUFFER_SIZE
- *   The size of the buffer.
+ * @def FASTA_INITIAL_CAPACITY
+ *   The initial size of the sequence buffer when the length of the sequence
+ *   is not known in advance.
+ */
+#define FASTA_INITIAL_CAPACITY 4096
+
+/**
+ * @def FASTA_READ_SIZE
+ *   The number of bytes read from the fasta file at a time while indexing.
+ */
+#define FASTA_READ_SIZE 1048576
+
+/**
+ * @def FASTA_CHUNK_SIZE
+ *   The default smallest part of a fasta file indexed by each thread (see
+ *   setFastaChunkSize).
+ */
+#define FASTA_CHUNK_SIZE 67108864
+
+/**
+ * @def FASTA_INDEX_EXTENSION
+ *   The extension of the fasta index file, which is compatible with the
+ *   .fai files written by samtools faidx.
  */
-#define FASTA_BUFFER_SIZE 4294967295
+#define FASTA_INDEX_EXTENSION ".fai"
+
+/**
+ * @def FASTA_QUALITY_OFFSET
+ *   The character of a quality value of 0 in a FASTQ file (Phred+33).
+ */
+#define FASTA_QUALITY_OFFSET '!'
+
+/**
+ * @def FASTA_MASK_CHARACTER
+ *   The character that replaces nucleotides with a low quality.
+ */
+#define FASTA_MASK_CHARACTER 'N'
+
+/**
+ * @def FASTA_TWOBIT_SIGNATURE
+ *   The signature at the start of a UCSC .2bit file.
+ */
+#define FASTA_TWOBIT_SIGNATURE 0x1A412743
+
+/**
+ * @def FASTA_UNKNOWN_OFFSET
+ *   The file offset of a header line that has not been found yet.
+ */
+#define FASTA_UNKNOWN_OFFSET SIZE_MAX
 
 /**
  * The structure to hold a Fasta object.
@@ -56,17 +109,59 @@
  */
 typedef struct Fasta {
   FILE * file;                     /**< A pointer to the fasta file. */
+  Gzip * gzip;                     /**< The compressed fasta file. */
+  int descriptor;                  /**< The file for positional reads. */
   size_t size;                     /**< The number of sequences. */
-  char ** ids;                     /**< An array of sequence identifiers. */
+  char * idArena;                  /**< The sequence identifiers. */
+  size_t idArenaSize;              /**< The bytes used in the arena. */
+  size_t idArenaCapacity;          /**< The bytes allocated to the arena. */
+  size_t * idOffsets;              /**< An array of identifier offsets. */
   size_t * lengths;                /**< An array of sequence lengths. */
   size_t * offsets;                /**< An array of file offsets. */
+  size_t * sequenceOffsets;        /**< An array of sequence data offsets. */
+  size_t * lineBases;              /**< An array of bases per line. */
+  size_t * lineWidths;             /**< An array of bytes per line. */
+  int regular;                     /**< True if every line is the same. */
+  char * map;                      /**< The fasta file mapped in memory. */
+  size_t mapSize;                  /**< The size of the mapped file. */
   size_t minimumLength;            /**< The minimum sequence length. */
   size_t current;                  /**< The current sequence. */
+  int streaming;                   /**< True if the file is read once. */
+  size_t capacity;                 /**< The room for streamed sequences. */
+  int fastq;                       /**< True if the file is FASTQ. */
+  int minimumQuality;              /**< The minimum nucleotide quality. */
+  size_t * idTable;                /**< A hash table of sequence indices. */
+  size_t idTableSize;              /**< The number of hash table slots. */
+  int twoBit;                      /**< True if the file is UCSC .2bit. */
+  int swapped;                     /**< True if the byte order is swapped. */
+  char * line;                     /**< A buffer for the lines read. */
+  size_t lineSize;                 /**< The bytes allocated to the line. */
 } Fasta;
 
 /**
  * Creates a new Fasta object from the given fasta formatted file.
  *
+ * The identifiers, lengths and file offsets of the sequences are read from
+ * the index file (the fasta file name followed by FASTA_INDEX_EXTENSION)
+ * if it is newer than the fasta file and agrees with its size.  Otherwise
+ * the fasta file is indexed, and the index file is written for next time.
+ * The fasta file is then mapped in memory for nextSequenceView.
+ *
+ * A gzip compressed fasta file is decompressed as it is read (see
+ * streamGzip), and is not mapped in memory.  The index file of a BGZF
+ * file holds the offsets of the decompressed data, the same as the index
+ * files written by samtools faidx.
+ *
+ * Standard input (the file name "-"), pipes and other files that can not
+ * seek are read as a stream (see newFastaStream), as are FASTQ files and
+ * gzip files that are not BGZF.
+ *
+ * A UCSC .2bit file, found by its signature, is read from the index at its
+ * start, and has no index file.  Its sequences are packed sequences (see
+ * packSequence), handed to the counting methods without being unpacked,
+ * with the blocks of N as ambiguous runs and the masked blocks as
+ * lowercase runs.
+ *
  * @memberof Fasta
  * @public
  * @param fileName The fasta formatted file to create this object from.
@@ -76,6 +171,28 @@ extern Fasta * newFasta (
   char * fileName
 );
 
+/**
+ * Creates a new Fasta object that reads the sequences from a stream.
+ *
+ * The stream is read once, in order, and never seeks.  Each call to
+ * nextSequence parses the next sequence, skipping the sequences shorter
+ * than the minimum length, so only a single sequence is held in memory at
+ * a time.  The identifiers and lengths of the sequences returned are kept,
+ * and numberSequences and getIdentifiers only count the sequences read so
+ * far.  The stream is closed by freeFasta, unless it is standard input.
+ *
+ * A stream that starts with an '@' is read as a FASTQ file.  The quality
+ * lines are only used to mask nucleotides (see setMinimumQuality).
+ *
+ * @memberof Fasta
+ * @public
+ * @param file The stream to read the sequences from.
+ * @return The new Fasta object, or NULL if the stream holds no sequences.
+ */
+extern Fasta * newFastaStream (
+  FILE * file
+);
+
 /**
  * Retrieves the next sequence from the fasta file.
  *
@@ -90,6 +207,211 @@ extern int nextSequence (
   Sequence ** seq
 );
 
+/**
+ * Retrieves a view of the next sequence in the fasta file.
+ *
+ * When the fasta file is mapped in memory and every sequence has lines of
+ * the same length, the sequence is a view of the mapped file (see
+ * viewSequence) with no description, and no sequence data is copied.
+ * Otherwise the sequence is parsed the same as with nextSequence.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param seq The sequence to be returned.
+ * @return True while there are still sequences in the buffer.
+ */
+extern int nextSequenceView (
+  Fasta * fasta,
+  Sequence ** seq
+);
+
+/**
+ * Retrieves the next sequence from the fasta file into a sequence object
+ * owned by the caller.
+ *
+ * The header line and sequence data are written over those of the last
+ * sequence, in buffers of the sequence object that only grow (see
+ * setHeader and reserveSequence).  Reading every sequence of a file into
+ * the same sequence object allocates no memory once the buffers have
+ * grown to fit the longest sequence, unlike nextSequence which creates a
+ * new sequence object each time.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param seq The sequence object to fill, created with newSequence.
+ * @return True while there are still sequences in the buffer.
+ */
+extern int nextSequenceInto (
+  Fasta * fasta,
+  Sequence * seq
+);
+
+/**
+ * Retrieves a view of the next sequence in the fasta file into a sequence
+ * object owned by the caller, the same as nextSequenceView.  The sequence
+ * object is reused the same as with nextSequenceInto.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param seq The sequence object to fill, created with newSequence.
+ * @return True while there are still sequences in the buffer.
+ */
+extern int nextSequenceViewInto (
+  Fasta * fasta,
+  Sequence * seq
+);
+
+/**
+ * Retrieves the sequence at an index in the fasta file.
+ *
+ * The sequence is found from the offset table, without reading the
+ * sequences before it.  The index counts every sequence in the fasta file,
+ * the same as getSubsequence, including those shorter than the minimum
+ * length.  The sequence is a view of the mapped file when possible, the
+ * same as with nextSequenceView.
+ *
+ * Several threads can look up sequences at the same time.  The fasta file
+ * is read with positional reads that share no file position, and views of
+ * the mapped file need no reads at all, so no locking is needed.  Only
+ * compressed files are read one thread at a time.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence in the fasta file.
+ * @return The sequence, which should be freed by the caller, or NULL if
+ *         the index is past the last sequence or the fasta file is read as
+ *         a stream.
+ */
+extern Sequence * getSequenceByIndex (
+  Fasta * fasta,
+  size_t index
+);
+
+/**
+ * Retrieves the sequence at an index in the fasta file into a sequence
+ * object owned by the caller, the same as getSequenceByIndex.  The
+ * sequence object is reused the same as with nextSequenceInto, so each
+ * thread can keep its own sequence object and read sequences at the same
+ * time as the others.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence in the fasta file.
+ * @param seq The sequence object to fill, created with newSequence.
+ * @return True if the sequence was found, false if the index is past the
+ *         last sequence or the fasta file is read as a stream.
+ */
+extern int getSequenceByIndexInto (
+  Fasta * fasta,
+  size_t index,
+  Sequence * seq
+);
+
+/**
+ * Claims the index of the next sequence in the fasta file that is long
+ * enough, moving the cursor of nextSequence past it.  The cursor is moved
+ * atomically, so several threads can claim sequences at once and read
+ * them with getSequenceByIndexInto.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param index Set to the index of the next sequence.
+ * @return True while there are still sequences in the buffer, and false
+ *         if the fasta file is read as a stream.
+ */
+extern int nextSequenceIndex (
+  Fasta * fasta,
+  size_t * index
+);
+
+/**
+ * Retrieves whether the fasta file is read as a stream, so its sequences
+ * can only be read in order with nextSequence.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @return True if the fasta file is read as a stream.
+ */
+extern int isStream (
+  Fasta * fasta
+);
+
+/**
+ * Retrieves whether the sequences of the fasta file are read with
+ * positional reads, so several threads can read sequences by index at the
+ * same time.  The sequences of a BGZF file are decompressed through a
+ * single stream shared by the threads, and are best read in order.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @return True if the sequences are read with positional reads.
+ */
+extern int isPositional (
+  Fasta * fasta
+);
+
+/**
+ * Retrieves whether reading the fasta file as a stream failed, such as a
+ * truncated or corrupt gzip file.  The sequences of a stream end at a read
+ * error, so this tells a read error apart from the end of the stream once
+ * nextSequence returns false.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @return True if the stream could not be read.
+ */
+extern int hasReadError (
+  Fasta * fasta
+);
+
+/**
+ * Retrieves the sequence with an identifier.
+ *
+ * The index of the sequence is found in a hash table of the identifiers,
+ * built when this object is created, and the sequence is retrieved the
+ * same as with getSequenceByIndex.  If several sequences share the
+ * identifier, the first is returned.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param id The identifier of the sequence.
+ * @return The sequence, which should be freed by the caller, or NULL if
+ *         there is no sequence with the identifier or the fasta file is
+ *         read as a stream.
+ */
+extern Sequence * getSequenceById (
+  Fasta * fasta,
+  char * id
+);
+
+/**
+ * Retrieves the identifier of the sequence at an index in the fasta file.
+ *
+ * The identifiers are stored end to end in a single arena, so the
+ * identifier is valid until this object is freed or, for a stream, until
+ * the next sequence is read.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence in the fasta file.
+ * @return The identifier, or NULL if the index is past the last sequence.
+ */
+extern char * getIdentifierByIndex (
+  Fasta * fasta,
+  size_t index
+);
+
 /**
  * Retrieves the number of sequences in this object.
  *
@@ -105,6 +427,9 @@ extern size_t numberSequences (
 /**
  * Retrieves the identifiers of the sequences in this object.
  *
+ * The array should be freed by the caller, but the identifiers point into
+ * the arena of this object (see getIdentifierByIndex) and should not be.
+ *
  * @memberof Fasta
  * @public
  * @param fasta This Fasta object.
@@ -128,26 +453,70 @@ extern void setMinimumLength (
 );
 
 /**
- * Close the file and free the memory reserved for this Fasta object.
+ * Set the minimum quality of the nucleotides in a FASTQ file.
+ *
+ * Nucleotides with a lower Phred quality are replaced with
+ * FASTA_MASK_CHARACTER as each sequence is parsed.  A minimum quality of 0,
+ * the default, masks nothing.  Fasta files have no quality values, and
+ * are not masked.
  *
  * @memberof Fasta
  * @public
- * @param fasta The Fasta object to free.
+ * @param fasta This Fasta object.
+ * @param quality The minimum quality.
  */
-extern void freeFasta (
-  Fasta * fasta
+extern void setMinimumQuality (
+  Fasta * fasta,
+  int quality
 );
 
 /**
- * Parse a sequence from the fasta file.
+ * Sets the smallest part of a fasta file indexed by each thread by the
+ * Fasta objects created afterwards, FASTA_CHUNK_SIZE by default.  The
+ * tests use a small chunk size to index small files in chunks.  It should
+ * not be changed while a Fasta object is being created.
  *
- * @private
- * @param file The file with the sequence to parse.
- * @param offset The file offset of the sequence to parse.
- * @return The sequence.
+ * @public
+ * @param chunkSize The smallest part of a fasta file indexed by each
+ *        thread.
  */
-static Sequence * parseSequence (
-  FILE * file
+extern void setFastaChunkSize (
+  size_t chunkSize
+);
+
+/**
+ * Retrieves part of a sequence from the fasta file.
+ *
+ * When every sequence has lines of the same length, the file offset of
+ * the subsequence is calculated from the line length, and only the lines
+ * holding the subsequence are read.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta This Fasta object.
+ * @param index The index of the sequence in the fasta file.
+ * @param start The position of the first nucleotide of the subsequence.
+ * @param length The length of the subsequence.
+ * @return The subsequence, which should be freed by the caller, or NULL if
+ *         start is past the end of the sequence or the fasta file is read
+ *         as a stream.
+ */
+extern char * getSubsequence (
+  Fasta * fasta,
+  size_t index,
+  size_t start,
+  size_t length
+);
+
+/**
+ * Close the file and free the memory reserved for this Fasta object.
+ *
+ * @memberof Fasta
+ * @public
+ * @param fasta The Fasta object to free.
+ */
+extern void freeFasta (
+  Fasta * fasta
 );
 
 #endif
@@ -0,0 +1,655 @@
+/*
+ *  Copyright (c) 2014, Jason M. Wood <sandain@hotmail.com>
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Reads gzip compressed files, with random access to BGZF files.
+ *
+ * @file gzip.c
+ */
+
+#define _GNU_SOURCE
+
+#include "gzip.h"
+
+/**
+ * Find the file offset and decompressed size of each block in a BGZF file.
+ *
+ * @private
+ * @param gzip This Gzip object.
+ * @return True if the file is a BGZF file.
+ */
+static int indexBgzf (
+  Gzip * gzip
+);
+
+/**
+ * Find the BGZF block holding a data offset.
+ *
+ * @private
+ * @param gzip This Gzip object.
+ * @param offset The data offset.
+ * @return The index of the block, or the number of blocks if the offset is
+ *         past the end of the data.
+ */
+static size_t findBlock (
+  Gzip * gzip,
+  size_t offset
+);
+
+/**
+ * Decompress a BGZF block.
+ *
+ * @private
+ * @param gzip This Gzip object.
+ * @param block The index of the block.
+ * @param data The buffer to hold the decompressed data of the block.
+ * @return True if the block was decompressed.
+ */
+static int decompressBlock (
+  Gzip * gzip,
+  size_t block,
+  char * data
+);
+
+/**
+ * Decompress the next batch of blocks from a BGZF file into the buffer.
+ *
+ * @private
+ * @param gzip This Gzip object.
+ * @return True if the buffer was filled.
+ */
+static int fillBgzf (
+  Gzip * gzip
+);
+
+/**
+ * Decompress more data from a gzip stream into the buffer.
+ *
+ * @private
+ * @param gzip This Gzip object.
+ * @return True if the buffer was filled.
+ */
+static int fillStream (
+  Gzip * gzip
+);
+
+/**
+ * Start decompressing a gzip stream over from the beginning of the file.
+ *
+ * @private
+ * @param gzip This Gzip object.
+ */
+static void rewindStream (
+  Gzip * gzip
+);
+
+/**
+ * Read decompressed data from the stream of a Gzip object.
+ *
+ * @private
+ * @param cookie This Gzip object.
+ * @param data The buffer to hold the data.
+ * @param size The number of bytes to read.
+ * @return The number of bytes read, or -1 once the data can not be
+ *         decompressed.
+ */
+static ssize_t readGzip (
+  void * cookie,
+  char * data,
+  size_t size
+);
+
+/**
+ * Seek to a data offset in the stream of a Gzip object.
+ *
+ * @private
+ * @param cookie This Gzip object.
+ * @param offset The offset to seek to, set to the new data offset.
+ * @param whence Where the offset is from, as with fseek.
+ * @return 0 on success, or -1 if the offset can not be reached.
+ */
+static int seekGzip (
+  void * cookie,
+  off64_t * offset,
+  int whence
+);
+
+/**
+ * Creates a new Gzip object from the given gzip compressed file.
+ *
+ * @memberof Gzip
+ * @public
+ * @param fileName The gzip compressed file to create this object from.
+ * @return The new Gzip object, or NULL if the file is not gzip compressed.
+ */
+Gzip * newGzip (
+  char * fileName
+) {
+  Gzip * gzip;
+  unsigned char magic[2];
+  int file = open (fileName, O_RDONLY);
+  if (file < 0) {
+    return NULL;
+  }
+  /* Verify that the file starts with the gzip magic number. */
+  if (pread (file, magic, 2, 0) != 2 || magic[0] != 0x1f || magic[1] != 0x8b) {
+    close (file);
+    return NULL;
+  }
+  gzip = malloc (sizeof (Gzip));
+  gzip->file = file;
+  gzip->size = 0;
+  gzip->blocks = 0;
+  gzip->blockOffsets = NULL;
+  gzip->dataOffsets = NULL;
+  gzip->next = 0;
+  gzip->batch = 1;
+  gzip->bgzf = indexBgzf (gzip);
+  gzip->input = NULL;
+  gzip->end = 0;
+  gzip->member = 1;
+  gzip->error = 0;
+  gzip->buffer = NULL;
+  gzip->capacity = 0;
+  if (! gzip->bgzf) {
+    /* Decompress the file as a stream of concatenated gzip members. */
+    memset (&gzip->stream, 0, sizeof (z_stream));
+    if (inflateInit2 (&gzip->stream, 15 + 16) != Z_OK) {
+      close (file);
+      free (gzip);
+      return NULL;
+    }
+    gzip->input = malloc (GZIP_BUFFER_SIZE * sizeof (unsigned char));
+    gzip->capacity = GZIP_HISTORY_SIZE + GZIP_BUFFER_SIZE;
+    gzip->buffer = malloc (gzip->capacity * sizeof (char));
+  }
+  gzip->start = 0;
+  gzip->length = 0;
+  gzip->position = 0;
+  return gzip;
+}
+
+/**
+ * Opens a stream that reads the decompressed data of the gzip file.
+ *
+ * @memberof Gzip
+ * @public
+ * @param gzip This Gzip object.
+ * @return The stream.
+ */
+FILE * streamGzip (
+  Gzip * gzip
+) {
+  cookie_io_functions_t functions = {
+    .read = readGzip,
+    .write = NULL,
+    .seek = seekGzip,
+    .close = NULL
+  };
+  return fopencookie (gzip, "r", functions);
+}
+
+/**
+ * Retrieves the virtual offset of a data offset in a BGZF file.
+ *
+ * @memberof Gzip
+ * @public
+ * @param gzip This Gzip object.
+ * @param offset The data offset.
+ * @return The virtual offset, or UINT64_MAX if the file is not BGZF or the
+ *         offset is past the end of the data.
+ */
+uint64_t getVirtualOffset (
+  Gzip * gzip,
+  size_t offset
+) {
+  size_t block;
+  if (! gzip->bgzf || offset >= gzip->size) {
+    return UINT64_MAX;
+  }
+  block = findBlock (gzip, offset);
+  return (uint64_t)gzip->blockOffsets[block] << 16 |
+    (offset - gzip->dataOffsets[block]);
+}
+
+/**
+ * Close the file and free the memory reserved for this Gzip object.
+ *
+ * @memberof Gzip
+ * @public
+ * @param gzip The Gzip object to free.
+ */
+void freeGzip (
+  Gzip * gzip
+) {
+  close (gzip->file);
+  if (! gzip->bgzf) {
+    inflateEnd (&gzip->stream);
+  }
+  free (gzip->blockOffsets);
+  free (gzip->dataOffsets);
+  free (gzip->input);
+  free (gzip->buffer);
+  free (gzip);
+}
+
+/**
+ * Find the file offset and decompressed size of each block in a BGZF file.
+ *
+ * Each BGZF block is a gzip member with the size of the block in a BC
+ * subfield of the extra field of its header, and the decompressed size of
+ * the block at the end of its footer, so the blocks are found by reading
+ * the headers and footers alone.
+ *
+ * @private
+ * @param gzip This Gzip object.
+ * @return True if the file is a BGZF file.
+ */
+static int indexBgzf (
+  Gzip * gzip
+) {
+  unsigned char header[18];
+  unsigned char footer[4];
+  size_t capacity = 0;
+  size_t offset = 0;
+  size_t blockSize, dataSize;
+  ssize_t length;
+  int valid = 1;
+  while (valid && (length = pread (gzip->file, header, 18, offset)) > 0) {
+    /* Verify that the header holds the block size. */
+    if (
+      length < 18 || header[0] != 0x1f || header[1] != 0x8b ||
+      header[2] != 8 || (header[3] & 4) == 0 || header[10] != 6 ||
+      header[11] != 0 || header[12] != 'B' || header[13] != 'C' ||
+      header[14] != 2 || header[15] != 0
+    ) {
+      valid = 0;
+      break;
+    }
+    blockSize = (header[16] | header[17] << 8) + 1;
+    if (
+      blockSize < 26 ||
+      pread (gzip->file, footer, 4, offset + blockSize - 4) != 4
+    ) {
+      valid = 0;
+      break;
+    }
+    dataSize = footer[0] | footer[1] << 8 | footer[2] << 16 |
+      (size_t)footer[3] << 24;
+    if (dataSize > GZIP_BLOCK_SIZE) {
+      valid = 0;
+      break;
+    }
+    /* Leave room for the end of the file after the last block. */
+    if (gzip->blocks + 1 >= capacity) {
+      capacity = capacity > 0 ? 2 * capacity : 1024;
+      gzip->blockOffsets = realloc (
+        gzip->blockOffsets, capacity * sizeof (size_t)
+      );
+      gzip->dataOffsets = realloc (
+        gzip->dataOffsets, capacity * sizeof (size_t)
+      );
+    }
+    gzip->blockOffsets[gzip->blocks] = offset;
+    gzip->dataOffsets[gzip->blocks] = gzip->size;
+    gzip->blocks ++;
+    gzip->size += dataSize;
+    offset += blockSize;
+  }
+  if (! valid || gzip->blocks == 0) {
+    free (gzip->blockOffsets);
+    free (gzip->dataOffsets);
+    gzip->blockOffsets = NULL;
+    gzip->dataOffsets = NULL;
+    gzip->blocks = 0;
+    gzip->size = 0;
+    return 0;
+  }
+  /* The block after the last block starts at the end of the file. */
+  gzip->blockOffsets[gzip->blocks] = offset;
+  gzip->dataOffsets[gzip->blocks] = gzip->size;
+  return 1;
+}
+
+/**
+ * Find the BGZF block holding a data offset.
+ *
+ * @private
+ * @param gzip This Gzip object.
+ * @param offset The data offset.
+ * @return The index of the block, or the number of blocks if the offset is
+ *         past the end of the data.
+ */
+static size_t findBlock (
+  Gzip * gzip,
+  size_t offset
+) {
+  size_t low = 0;
+  size_t high = gzip->blocks;
+  size_t middle;
+  if (offset >= gzip->size) {
+    return gzip->blocks;
+  }
+  /* Find the last block that starts at or before the offset. */
+  while (high - low > 1) {
+    middle = low + (high - low) / 2;
+    if (gzip->dataOffsets[middle] <= offset) {
+      low = middle;
+    }
+    else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+/**
+ * Decompress a BGZF block.
+ *
+ * @private
+ * @param gzip This Gzip object.
+ * @param block The index of the block.
+ * @param data The buffer to hold the decompressed data of the block.
+ * @return True if the block was decompressed.
+ */
+static int decompressBlock (
+  Gzip * gzip,
+  size_t block,
+  char * data
+) {
+  unsigned char input[GZIP_BLOCK_SIZE];
+  z_stream stream;
+  size_t blockSize = gzip->blockOffsets[block + 1] -
+    gzip->blockOffsets[block];
+  size_t dataSize = gzip->dataOffsets[block + 1] - gzip->dataOffsets[block];
+  int status;
+  /* Empty blocks, such as the end of file marker, hold no data. */
+  if (dataSize == 0) {
+    return 1;
+  }
+  if (
+    pread (gzip->file, input, blockSize, gzip->blockOffsets[block]) !=
+    (ssize_t)blockSize
+  ) {
+    return 0;
+  }
+  memset (&stream, 0, sizeof (z_stream));
+  if (inflateInit2 (&stream, 15 + 16) != Z_OK) {
+    return 0;
+  }
+  stream.next_in = input;
+  stream.avail_in = blockSize;
+  stream.next_out = (Bytef *)data;
+  stream.avail_out = dataSize;
+  status = inflate (&stream, Z_FINISH);
+  inflateEnd (&stream);
+  return status == Z_STREAM_END && stream.avail_out == 0;
+}
+
+/**
+ * Decompress the next batch of blocks from a BGZF file into the buffer.
+ *
+ * Each block of the batch is decompressed on its own thread.  The batch
+ * starts with a single block after each seek, and doubles in size up to
+ * GZIP_BATCH_BLOCKS blocks while the file is read in order.  A batch with
+ * a block that can not be decompressed sets the error flag of this Gzip
+ * object, and leaves the buffer empty.
+ *
+ * @private
+ * @param gzip This Gzip object.
+ * @return True if the buffer was filled.
+ */
+static int fillBgzf (
+  Gzip * gzip
+) {
+  size_t first = gzip->next;
+  size_t number, size, i;
+  int errors = 0;
+  if (first >= gzip->blocks) {
+    return 0;
+  }
+  number = gzip->blocks - first;
+  if (number > gzip->batch) {
+    number = gzip->batch;
+  }
+  size = gzip->dataOffsets[first + number] - gzip->dataOffsets[first];
+  if (size > gzip->capacity) {
+    gzip->capacity = size;
+    gzip->buffer = realloc (gzip->buffer, gzip->capacity * sizeof (char));
+  }
+  #pragma omp parallel for reduction (+:errors)
+  for (i = 0; i < number; i ++) {
+    errors += ! decompressBlock (
+      gzip, first + i,
+      gzip->buffer + gzip->dataOffsets[first + i] - gzip->dataOffsets[first]
+    );
+  }
+  /* A batch that can not be decompressed is not moved past, so that the
+     data offsets of the buffer stay behind the current data offset. */
+  if (errors > 0) {
+    gzip->length = 0;
+    gzip->error = 1;
+    return 0;
+  }
+  gzip->start = gzip->dataOffsets[first];
+  gzip->length = size;
+  gzip->next = first + number;
+  if (gzip->batch < GZIP_BATCH_BLOCKS) {
+    gzip->batch *= 2;
+  }
+  return 1;
+}
+
+/**
+ * Decompress more data from a gzip stream into the buffer.
+ *
+ * The last GZIP_HISTORY_SIZE bytes in the buffer are kept at the start of
+ * the buffer, and the rest of the buffer is filled.  The stream carries on
+ * through each gzip member of a file made of several members.  A file that
+ * ends inside a member, or a member that can not be decompressed, sets the
+ * error flag of this Gzip object, while data after the last member that is
+ * not a gzip member is ignored, the same as gzip does.
+ *
+ * @private
+ * @param gzip This Gzip object.
+ * @return True if the buffer was filled.
+ */
+static int fillStream (
+  Gzip * gzip
+) {
+  size_t keep, filled;
+  ssize_t bytes;
+  int status;
+  if (gzip->end) {
+    return 0;
+  }
+  /* Keep the end of the buffer for short seeks backwards. */
+  keep = gzip->length < GZIP_HISTORY_SIZE ? gzip->length : GZIP_HISTORY_SIZE;
+  memmove (gzip->buffer, gzip->buffer + gzip->length - keep, keep);
+  gzip->start += gzip->length - keep;
+  gzip->length = keep;
+  gzip->stream.next_out = (Bytef *)gzip->buffer + keep;
+  gzip->stream.avail_out = gzip->capacity - keep;
+  while (gzip->stream.avail_out > 0) {
+    if (gzip->stream.avail_in == 0) {
+      bytes = read (gzip->file, gzip->input, GZIP_BUFFER_SIZE);
+      if (bytes <= 0) {
+        gzip->end = 1;
+        gzip->error = bytes < 0 || gzip->member;
+        break;
+      }
+      gzip->stream.next_in = gzip->input;
+      gzip->stream.avail_in = bytes;
+    }
+    status = inflate (&gzip->stream, Z_NO_FLUSH);
+    if (status == Z_STREAM_END) {
+      /* Start on the next gzip member. */
+      inflateReset (&gzip->stream);
+      gzip->member = 0;
+    }
+    else if (status == Z_OK) {
+      gzip->member = 1;
+    }
+    else {
+      gzip->end = 1;
+      gzip->error = gzip->member;
+      break;
+    }
+  }
+  filled = gzip->capacity - keep - gzip->stream.avail_out;
+  gzip->length += filled;
+  return filled > 0;
+}
+
+/**
+ * Start decompressing a gzip stream over from the beginning of the file.
+ *
+ * @private
+ * @param gzip This Gzip object.
+ */
+static void rewindStream (
+  Gzip * gzip
+) {
+  lseek (gzip->file, 0, SEEK_SET);
+  inflateReset (&gzip->stream);
+  gzip->stream.avail_in = 0;
+  gzip->end = 0;
+  gzip->member = 1;
+  gzip->start = 0;
+  gzip->length = 0;
+}
+
+/**
+ * Read decompressed data from the stream of a Gzip object.
+ *
+ * @private
+ * @param cookie This Gzip object.
+ * @param data The buffer to hold the data.
+ * @param size The number of bytes to read.
+ * @return The number of bytes read, or -1 once the data can not be
+ *         decompressed.
+ */
+static ssize_t readGzip (
+  void * cookie,
+  char * data,
+  size_t size
+) {
+  Gzip * gzip = cookie;
+  size_t copied = 0;
+  size_t number;
+  int filled;
+  if (gzip->error) {
+    return -1;
+  }
+  while (copied < size) {
+    /* Decompress more data once the buffer has been read. */
+    if (gzip->position >= gzip->start + gzip->length) {
+      filled = gzip->bgzf ? fillBgzf (gzip) : fillStream (gzip);
+      if (! filled) {
+        if (gzip->error && copied == 0) {
+          return -1;
+        }
+        break;
+      }
+      continue;
+    }
+    number = gzip->start + gzip->length - gzip->position;
+    if (number > size - copied) {
+      number = size - copied;
+    }
+    memcpy (
+      data + copied, gzip->buffer + gzip->position - gzip->start, number
+    );
+    copied += number;
+    gzip->position += number;
+  }
+  return copied;
+}
+
+/**
+ * Seek to a data offset in the stream of a Gzip object.
+ *
+ * Offsets held in the buffer are reached without decompressing any data.
+ * Otherwise a BGZF file starts decompressing at the block holding the
+ * offset, and a gzip stream starts over from the beginning of the file to
+ * seek backwards, and decompresses up to the offset to seek forwards.
+ *
+ * @private
+ * @param cookie This Gzip object.
+ * @param offset The offset to seek to, set to the new data offset.
+ * @param whence Where the offset is from, as with fseek.
+ * @return 0 on success, or -1 if the offset can not be reached.
+ */
+static int seekGzip (
+  void * cookie,
+  off64_t * offset,
+  int whence
+) {
+  Gzip * gzip = cookie;
+  off64_t position;
+  size_t block;
+  switch (whence) {
+    case SEEK_SET:
+      position = *offset;
+      break;
+    case SEEK_CUR:
+      position = gzip->position + *offset;
+      break;
+    case SEEK_END:
+      /* Only the size of the data in a BGZF file is known. */
+      if (! gzip->bgzf) {
+        return -1;
+      }
+      position = gzip->size + *offset;
+      break;
+    default:
+      return -1;
+  }
+  if (position < 0) {
+    return -1;
+  }
+  if (
+    (size_t)position < gzip->start ||
+    (gzip->bgzf && (size_t)position > gzip->start + gzip->length)
+  ) {
+    if (gzip->bgzf) {
+      block = findBlock (gzip, position);
+      gzip->next = block;
+      gzip->batch = 1;
+      gzip->start = block < gzip->blocks ?
+        gzip->dataOffsets[block] : gzip->size;
+      gzip->length = 0;
+    }
+    else {
+      rewindStream (gzip);
+    }
+  }
+  gzip->position = position;
+  *offset = position;
+  return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ *  Copyright (c) 2014, Jason M. Wood <sandain@hotmail.com>
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Reads gzip compressed files, with random access to BGZF files.
+ *
+ * @file gzip.h
+ */
+
+#ifndef _OLIGO_GZIP_H
+#define _OLIGO_GZIP_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+/**
+ * @def GZIP_BUFFER_SIZE
+ *   The number of bytes decompressed at a time from a gzip file.
+ */
+#define GZIP_BUFFER_SIZE 1048576
+
+/**
+ * @def GZIP_HISTORY_SIZE
+ *   The number of decompressed bytes kept from the previous buffer, so that
+ *   short seeks backwards in a gzip file do not start over from the
+ *   beginning of the file.
+ */
+#define GZIP_HISTORY_SIZE 65536
+
+/**
+ * @def GZIP_BATCH_BLOCKS
+ *   The largest number of BGZF blocks decompressed at a time, one block to
+ *   each thread.
+ */
+#define GZIP_BATCH_BLOCKS 64
+
+/**
+ * @def GZIP_BLOCK_SIZE
+ *   The largest size of a BGZF block, compressed or decompressed.
+ */
+#define GZIP_BLOCK_SIZE 65536
+
+/**
+ * The structure to hold a Gzip object.
+ *
+ * @public
+ */
+typedef struct Gzip {
+  int file;                        /**< The compressed file. */
+  int bgzf;                        /**< True if the file is BGZF. */
+  size_t size;                     /**< The decompressed size of a BGZF. */
+  size_t blocks;                   /**< The number of BGZF blocks. */
+  size_t * blockOffsets;           /**< An array of block file offsets. */
+  size_t * dataOffsets;            /**< An array of block data offsets. */
+  size_t next;                     /**< The next block to decompress. */
+  size_t batch;                    /**< The blocks to decompress at a time. */
+  z_stream stream;                 /**< The state of a gzip stream. */
+  unsigned char * input;           /**< The compressed data of a stream. */
+  int end;                         /**< True at the end of a gzip stream. */
+  int member;                      /**< True inside a gzip member. */
+  int error;                       /**< True once decompression failed. */
+  char * buffer;                   /**< The decompressed data. */
+  size_t capacity;                 /**< The size of the buffer. */
+  size_t start;                    /**< The data offset of the buffer. */
+  size_t length;                   /**< The bytes of data in the buffer. */
+  size_t position;                 /**< The current data offset. */
+} Gzip;
+
+/**
+ * Creates a new Gzip object from the given gzip compressed file.
+ *
+ * The file is a BGZF file (as written by bgzip) if every gzip member in it
+ * is a BGZF block.  The file offset and decompressed size of each block
+ * are then read from the block headers and footers, without decompressing
+ * the blocks.
+ *
+ * @memberof Gzip
+ * @public
+ * @param fileName The gzip compressed file to create this object from.
+ * @return The new Gzip object, or NULL if the file is not gzip compressed.
+ */
+extern Gzip * newGzip (
+  char * fileName
+);
+
+/**
+ * Opens a stream that reads the decompressed data of the gzip file.
+ *
+ * The stream can seek to any data offset.  A BGZF file seeks straight to
+ * the block holding the offset, and decompresses blocks on several threads
+ * while the stream is read in order.  A gzip file that is not BGZF is
+ * decompressed from the beginning of the file to seek backwards, unless
+ * the offset is among the last GZIP_HISTORY_SIZE bytes read.  Once a block
+ * or gzip member can not be decompressed, or the file ends inside a gzip
+ * member, every read of the stream fails, setting the
+ * error indicator of the stream (see ferror).  Closing the stream does not
+ * free this Gzip object.
+ *
+ * @memberof Gzip
+ * @public
+ * @param gzip This Gzip object.
+ * @return The stream.
+ */
+extern FILE * streamGzip (
+  Gzip * gzip
+);
+
+/**
+ * Retrieves the virtual offset of a data offset in a BGZF file.
+ *
+ * The virtual offset holds the file offset of the block holding the data
+ * in the upper 48 bits, and the offset of the data in the decompressed
+ * block in the lower 16 bits, the same as the virtual offsets used by
+ * samtools.
+ *
+ * @memberof Gzip
+ * @public
+ * @param gzip This Gzip object.
+ * @param offset The data offset.
+ * @return The virtual offset, or UINT64_MAX if the file is not BGZF or the
+ *         offset is past the end of the data.
+ */
+extern uint64_t getVirtualOffset (
+  Gzip * gzip,
+  size_t offset
+);
+
+/**
+ * Close the file and free the memory reserved for this Gzip object.
+ *
+ * @memberof Gzip
+ * @public
+ * @param gzip The Gzip object to free.
+ */
+extern void freeGzip (
+  Gzip * gzip
+);
+
+#endif
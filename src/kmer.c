@@ -0,0 +1,964 @@
+/*
+ *  Copyright (c) 2014, Jason M. Wood <sandain@hotmail.com>
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Counts the oligonucleotides found in sequence data.
+ *
+ * @file kmer.c
+ */
+
+#include "kmer.h"
+
+/* Force the counting kernel to be inlined into each specialized kernel. */
+#ifdef __GNUC__
+#define KMER_INLINE static inline __attribute__((always_inline))
+#else
+#define KMER_INLINE static inline
+#endif
+
+/**
+ * The 2 bit codes of the nucleotides in each IUPAC bitmask.
+ *
+ * @private
+ */
+static const unsigned char expansionCodes[16][4] = {
+  {0, 0, 0, 0}, {0, 0, 0, 0}, {1, 0, 0, 0}, {0, 1, 0, 0},
+  {2, 0, 0, 0}, {0, 2, 0, 0}, {1, 2, 0, 0}, {0, 1, 2, 0},
+  {3, 0, 0, 0}, {0, 3, 0, 0}, {1, 3, 0, 0}, {0, 1, 3, 0},
+  {2, 3, 0, 0}, {0, 2, 3, 0}, {1, 2, 3, 0}, {0, 1, 2, 3}
+};
+
+/**
+ * The number of nucleotides in each IUPAC bitmask.
+ *
+ * @private
+ */
+static const unsigned char expansionSizes[16] = {
+  0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
+
+/**
+ * Spread the count of a single ambiguous oligo over the oligos compatible
+ * with it.
+ *
+ * @private
+ * @param oligo The start of the oligo in the sequence data.
+ * @param oligoLength The length of the oligo.
+ * @param canonical Count each oligo at the code of its canonical oligo.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return 1 if the oligo was spread, 0 if it was skipped.
+ */
+static int spreadOligo (
+  char * oligo,
+  size_t oligoLength,
+  int canonical,
+  double * counts
+) {
+  size_t positions[KMER_MAX_LENGTH];
+  unsigned char masks[KMER_MAX_LENGTH];
+  unsigned char choices[KMER_MAX_LENGTH] = {0};
+  size_t numAmbiguous = 0;
+  size_t numExpansions = 1;
+  size_t i, p;
+  uint64_t code = 0;
+  uint64_t oligoCode, reverse;
+  double share;
+  /* Build the code of the unambiguous nucleotides, and note where each
+     ambiguous nucleotide is. */
+  for (p = 0; p < oligoLength; p ++) {
+    unsigned char mask = nucleotideMasks[(unsigned char)oligo[p]];
+    if (mask == 0 || mask > 15) {
+      return 0;
+    }
+    if (expansionSizes[mask] == 1) {
+      code |= (uint64_t)expansionCodes[mask][0] << (2 * p);
+      continue;
+    }
+    numExpansions *= expansionSizes[mask];
+    if (numExpansions > KMER_MAX_EXPANSIONS) {
+      return 0;
+    }
+    positions[numAmbiguous] = p;
+    masks[numAmbiguous] = mask;
+    numAmbiguous ++;
+  }
+  share = 1.0 / numExpansions;
+  /* Step through every combination of the ambiguous nucleotides. */
+  for (;;) {
+    oligoCode = code;
+    for (i = 0; i < numAmbiguous; i ++) {
+      oligoCode |= (uint64_t)expansionCodes[masks[i]][choices[i]] <<
+        (2 * positions[i]);
+    }
+    if (canonical) {
+      reverse = reverseComplementCode (oligoCode, oligoLength);
+      if (reverse < oligoCode) {
+        oligoCode = reverse;
+      }
+    }
+    counts[oligoCode] += share;
+    for (i = 0; i < numAmbiguous; i ++) {
+      if (++ choices[i] < expansionSizes[masks[i]]) {
+        break;
+      }
+      choices[i] = 0;
+    }
+    if (i == numAmbiguous) {
+      break;
+    }
+  }
+  return 1;
+}
+
+/**
+ * Generate all of the nucleotide combinations for the given length using a
+ * recursive method.
+ *
+ * @public
+ * @param oligoLength The length of oligonucleotides to generate.
+ * @param oligonucleotides The final list of oligonucleotides generated.
+ * @param oligo The oligo being generated via recursion.
+ * @param index The index of oligonucleotides to store the resulting
+ *        oligonucleotide in.
+ */
+void generateOligonucleotides (
+  size_t oligoLength,
+  char ** oligonucleotides,
+  char * oligo,
+  size_t index
+) {
+  char nucs[4] = {'a', 'c', 'g', 't'};
+  size_t i;
+  size_t length = strlen(oligo);
+  /* If oligo is not long enough, append the four nucleotides to oligo and
+     recurse. If oligo is long enough, push the oligo onto the
+     oligonucleotides array and return. */
+  if (oligoLength > length) {
+    /* Make a local copy of the oligo. */
+    char buffer[oligoLength + 1];
+    strcpy (buffer, oligo);
+    for (i = 0; i < 4; i ++) {
+      buffer[length] = nucs[i];
+      buffer[length + 1] = '\0';
+      generateOligonucleotides (
+        oligoLength, oligonucleotides, buffer, index + i * power (4, length)
+      );
+    }
+  }
+  else {
+    oligonucleotides[index] = strdup (oligo);
+  }
+}
+
+/**
+ * The body of countOligos.  It is inlined into a kernel for each short
+ * oligo length, where oligoLength is a constant and the shifts and tests
+ * that depend on it are resolved by the compiler, and into the generic
+ * kernel used for every other length.
+ *
+ * @private
+ * @param sequence The sequence data, used when packed is NULL.
+ * @param packed The packed nucleotides, or NULL.
+ * @param start The position of the first packed nucleotide to use.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of oligos counted.
+ */
+KMER_INLINE size_t countOligosKernel (
+  char * sequence,
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  const size_t oligoLength,
+  size_t stepSize,
+  double * counts
+) {
+  uint8_t codes[KMER_BLOCK_LENGTH / 4];
+  uint64_t ambiguous[KMER_BLOCK_LENGTH / 64];
+  char buffer[KMER_BLOCK_LENGTH];
+  char * block;
+  size_t offset, used, blockLength;
+  size_t word, wordEnd;
+  size_t i;
+  size_t shift;
+  size_t position = 0;
+  size_t valid = 0;
+  size_t phase = 0;
+  size_t number = 0;
+  uint64_t code = 0;
+  shift = 2 * (oligoLength - 1);
+  for (offset = 0; offset < length; offset += used) {
+    /* Gather the next block of nucleotides, skipping line breaks. */
+    used = gatherNucleotides (
+      sequence, packed, start + offset, length - offset, buffer,
+      KMER_BLOCK_LENGTH, &block, &blockLength, codes, ambiguous
+    );
+    /* Work through the block 64 nucleotides (one word of the ambiguity
+       mask) at a time. */
+    for (word = 0; word < blockLength; word += 64) {
+      wordEnd = word + 64;
+      if (wordEnd > blockLength) {
+        wordEnd = blockLength;
+      }
+      /* Every oligo ending in a run of unambiguous nucleotides is counted
+         when every position is used. */
+      if (ambiguous[word / 64] == 0 && stepSize == 1 && valid >= oligoLength) {
+        if (wordEnd - word == 64) {
+          /* Unroll the four nucleotides of each byte of a full word. */
+          for (i = word / 4; i < wordEnd / 4; i ++) {
+            uint64_t byte = codes[i];
+            code = (code >> 2) | ((byte & 3) << shift);
+            counts[code] ++;
+            code = (code >> 2) | (((byte >> 2) & 3) << shift);
+            counts[code] ++;
+            code = (code >> 2) | (((byte >> 4) & 3) << shift);
+            counts[code] ++;
+            code = (code >> 2) | ((byte >> 6) << shift);
+            counts[code] ++;
+          }
+        }
+        else {
+          for (i = word; i < wordEnd; i ++) {
+            code = (code >> 2) |
+              ((uint64_t)((codes[i / 4] >> (2 * (i % 4))) & 3) << shift);
+            counts[code] ++;
+          }
+        }
+        number += wordEnd - word;
+        valid += wordEnd - word;
+        position += wordEnd - word;
+        continue;
+      }
+      for (i = word; i < wordEnd; i ++) {
+        /* Roll the nucleotide into the code, or start over if the
+           nucleotide is ambiguous. */
+        if ((ambiguous[i / 64] >> (i % 64)) & 1) {
+          valid = 0;
+        }
+        else {
+          code = (code >> 2) |
+            ((uint64_t)((codes[i / 4] >> (2 * (i % 4))) & 3) << shift);
+          valid ++;
+        }
+        /* Count the oligo ending at this nucleotide if it starts on a step
+           boundary and contains only unambiguous nucleotides. */
+        position ++;
+        if (position >= oligoLength) {
+          if (phase == 0 && valid >= oligoLength) {
+            counts[code] ++;
+            number ++;
+          }
+          phase ++;
+          if (phase == stepSize) {
+            phase = 0;
+          }
+        }
+      }
+    }
+  }
+  return number;
+}
+
+/**
+ * Define a countOligos kernel specialized for oligos of length k.
+ *
+ * @private
+ */
+#define KMER_KERNEL(k) \
+  static size_t countOligos##k ( \
+    char * sequence, \
+    PackedNucleotides * packed, \
+    size_t start, \
+    size_t length, \
+    size_t stepSize, \
+    double * counts \
+  ) { \
+    return countOligosKernel ( \
+      sequence, packed, start, length, k, stepSize, counts \
+    ); \
+  }
+
+KMER_KERNEL (1)
+KMER_KERNEL (2)
+KMER_KERNEL (3)
+KMER_KERNEL (4)
+KMER_KERNEL (5)
+KMER_KERNEL (6)
+KMER_KERNEL (7)
+KMER_KERNEL (8)
+
+/**
+ * Count the oligos found in a stretch of sequence data or packed
+ * nucleotides, with the kernel specialized for the oligo length if there
+ * is one.
+ *
+ * @private
+ * @param sequence The sequence data, used when packed is NULL.
+ * @param packed The packed nucleotides, or NULL.
+ * @param start The position of the first packed nucleotide to use.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of oligos counted.
+ */
+static size_t countOligosFrom (
+  char * sequence,
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  double * counts
+) {
+  if (oligoLength == 0 || oligoLength > KMER_MAX_LENGTH || stepSize == 0) {
+    return 0;
+  }
+  switch (oligoLength) {
+    case 1 : return countOligos1 (
+               sequence, packed, start, length, stepSize, counts
+             );
+    case 2 : return countOligos2 (
+               sequence, packed, start, length, stepSize, counts
+             );
+    case 3 : return countOligos3 (
+               sequence, packed, start, length, stepSize, counts
+             );
+    case 4 : return countOligos4 (
+               sequence, packed, start, length, stepSize, counts
+             );
+    case 5 : return countOligos5 (
+               sequence, packed, start, length, stepSize, counts
+             );
+    case 6 : return countOligos6 (
+               sequence, packed, start, length, stepSize, counts
+             );
+    case 7 : return countOligos7 (
+               sequence, packed, start, length, stepSize, counts
+             );
+    case 8 : return countOligos8 (
+               sequence, packed, start, length, stepSize, counts
+             );
+    default: return countOligosKernel (
+               sequence, packed, start, length, oligoLength, stepSize, counts
+             );
+  }
+}
+
+/**
+ * Count the oligos found in a stretch of sequence data.
+ *
+ * @public
+ * @param sequence The sequence data.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of oligos counted.
+ */
+size_t countOligos (
+  char * sequence,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  double * counts
+) {
+  return countOligosFrom (
+    sequence, NULL, 0, length, oligoLength, stepSize, counts
+  );
+}
+
+/**
+ * Count the oligos found in a stretch of packed nucleotides.
+ *
+ * @public
+ * @param packed The packed nucleotides.
+ * @param start The position of the first nucleotide to use.
+ * @param length The number of nucleotides to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of oligos counted.
+ */
+size_t countPackedOligos (
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  double * counts
+) {
+  return countOligosFrom (
+    NULL, packed, start, length, oligoLength, stepSize, counts
+  );
+}
+
+/**
+ * Count the canonical oligos found in a stretch of sequence data or packed
+ * nucleotides.
+ *
+ * @private
+ * @param sequence The sequence data, used when packed is NULL.
+ * @param packed The packed nucleotides, or NULL.
+ * @param start The position of the first packed nucleotide to use.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of oligos counted.
+ */
+static size_t countCanonicalOligosFrom (
+  char * sequence,
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  double * counts
+) {
+  uint8_t codes[KMER_BLOCK_LENGTH / 4];
+  uint64_t ambiguous[KMER_BLOCK_LENGTH / 64];
+  char buffer[KMER_BLOCK_LENGTH];
+  char * block;
+  size_t offset, used, blockLength;
+  size_t i;
+  size_t shift;
+  size_t position = 0;
+  size_t valid = 0;
+  size_t phase = 0;
+  size_t number = 0;
+  uint64_t mask;
+  uint64_t nuc;
+  uint64_t code = 0;
+  uint64_t reverse = 0;
+  if (oligoLength == 0 || oligoLength > KMER_MAX_LENGTH || stepSize == 0) {
+    return 0;
+  }
+  shift = 2 * (oligoLength - 1);
+  mask = ((uint64_t)1 << (2 * oligoLength)) - 1;
+  for (offset = 0; offset < length; offset += used) {
+    /* Gather the next block of nucleotides, skipping line breaks. */
+    used = gatherNucleotides (
+      sequence, packed, start + offset, length - offset, buffer,
+      KMER_BLOCK_LENGTH, &block, &blockLength, codes, ambiguous
+    );
+    for (i = 0; i < blockLength; i ++) {
+      /* Roll the nucleotide into the forward code, and its complement into
+         the reverse complement code, or start over if the nucleotide is
+         ambiguous.  The newest nucleotide is the last of the forward oligo
+         and the first of the reverse complement. */
+      if ((ambiguous[i / 64] >> (i % 64)) & 1) {
+        valid = 0;
+      }
+      else {
+        nuc = (codes[i / 4] >> (2 * (i % 4))) & 3;
+        code = (code >> 2) | (nuc << shift);
+        reverse = ((reverse << 2) | (3 - nuc)) & mask;
+        valid ++;
+      }
+      /* Count the canonical oligo ending at this nucleotide if it starts on
+         a step boundary and contains only unambiguous nucleotides. */
+      position ++;
+      if (position >= oligoLength) {
+        if (phase == 0 && valid >= oligoLength) {
+          counts[code < reverse ? code : reverse] ++;
+          number ++;
+        }
+        phase ++;
+        if (phase == stepSize) {
+          phase = 0;
+        }
+      }
+    }
+  }
+  return number;
+}
+
+/**
+ * Count the canonical oligos found in a stretch of sequence data.
+ *
+ * @public
+ * @param sequence The sequence data.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of oligos counted.
+ */
+size_t countCanonicalOligos (
+  char * sequence,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  double * counts
+) {
+  return countCanonicalOligosFrom (
+    sequence, NULL, 0, length, oligoLength, stepSize, counts
+  );
+}
+
+/**
+ * Count the canonical oligos found in a stretch of packed nucleotides.
+ *
+ * @public
+ * @param packed The packed nucleotides.
+ * @param start The position of the first nucleotide to use.
+ * @param length The number of nucleotides to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of oligos counted.
+ */
+size_t countPackedCanonicalOligos (
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  double * counts
+) {
+  return countCanonicalOligosFrom (
+    NULL, packed, start, length, oligoLength, stepSize, counts
+  );
+}
+
+/**
+ * Count the oligos of every length in a range found in a stretch of
+ * sequence data or packed nucleotides, in a single pass.
+ *
+ * @private
+ * @param sequence The sequence data, used when packed is NULL.
+ * @param packed The packed nucleotides, or NULL.
+ * @param start The position of the first packed nucleotide to use.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param minLength The length of the shortest oligos.
+ * @param maxLength The length of the longest oligos.
+ * @param overlapping Count every overlapping oligo instead of consecutive
+ *        non-overlapping oligos of each length.
+ * @param canonical Count each oligo at the code of its canonical oligo.
+ * @param counts The array of 4^oligoLength counts to increment for each
+ *        oligo length, starting with minLength.
+ * @param totals The number of oligos counted of each length, starting with
+ *        minLength, is added to this array.
+ * @return The number of oligos counted of every length.
+ */
+static size_t countOligoRangeFrom (
+  char * sequence,
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  size_t minLength,
+  size_t maxLength,
+  int overlapping,
+  int canonical,
+  double ** counts,
+  double * totals
+) {
+  uint8_t codes[KMER_BLOCK_LENGTH / 4];
+  uint64_t ambiguous[KMER_BLOCK_LENGTH / 64];
+  size_t phases[KMER_MAX_LENGTH + 1];
+  char buffer[KMER_BLOCK_LENGTH];
+  char * block;
+  size_t offset, used, blockLength;
+  size_t i, k;
+  size_t shift;
+  size_t position = 0;
+  size_t valid = 0;
+  size_t number = 0;
+  uint64_t mask;
+  uint64_t nuc;
+  uint64_t code = 0;
+  uint64_t reverse = 0;
+  uint64_t oligo, reverseOligo;
+  if (minLength == 0 || minLength > maxLength || maxLength > KMER_MAX_LENGTH) {
+    return 0;
+  }
+  shift = 2 * (maxLength - 1);
+  mask = ((uint64_t)1 << (2 * maxLength)) - 1;
+  for (k = minLength; k <= maxLength; k ++) {
+    phases[k] = 0;
+  }
+  for (offset = 0; offset < length; offset += used) {
+    /* Gather the next block of nucleotides, skipping line breaks. */
+    used = gatherNucleotides (
+      sequence, packed, start + offset, length - offset, buffer,
+      KMER_BLOCK_LENGTH, &block, &blockLength, codes, ambiguous
+    );
+    for (i = 0; i < blockLength; i ++) {
+      /* Roll the nucleotide into the codes of the longest oligo, or start
+         over if the nucleotide is ambiguous. */
+      if ((ambiguous[i / 64] >> (i % 64)) & 1) {
+        valid = 0;
+      }
+      else {
+        nuc = (codes[i / 4] >> (2 * (i % 4))) & 3;
+        code = (code >> 2) | (nuc << shift);
+        reverse = ((reverse << 2) | (3 - nuc)) & mask;
+        valid ++;
+      }
+      position ++;
+      /* Count the oligo of each length that ends at this nucleotide. */
+      for (k = minLength; k <= maxLength && k <= position; k ++) {
+        if (phases[k] == 0 && valid >= k) {
+          oligo = code >> (2 * (maxLength - k));
+          if (canonical) {
+            reverseOligo = reverse & (((uint64_t)1 << (2 * k)) - 1);
+            if (reverseOligo < oligo) {
+              oligo = reverseOligo;
+            }
+          }
+          counts[k - minLength][oligo] ++;
+          totals[k - minLength] ++;
+          number ++;
+        }
+        if (! overlapping) {
+          phases[k] ++;
+          if (phases[k] == k) {
+            phases[k] = 0;
+          }
+        }
+      }
+    }
+  }
+  return number;
+}
+
+/**
+ * Count the oligos of every length in a range found in a stretch of
+ * sequence data, in a single pass.
+ *
+ * @public
+ * @param sequence The sequence data.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param minLength The length of the shortest oligos.
+ * @param maxLength The length of the longest oligos.
+ * @param overlapping Count every overlapping oligo instead of consecutive
+ *        non-overlapping oligos of each length.
+ * @param canonical Count each oligo at the code of its canonical oligo.
+ * @param counts The array of 4^oligoLength counts to increment for each
+ *        oligo length, starting with minLength.
+ * @param totals The number of oligos counted of each length, starting with
+ *        minLength, is added to this array.
+ * @return The number of oligos counted of every length.
+ */
+size_t countOligoRange (
+  char * sequence,
+  size_t length,
+  size_t minLength,
+  size_t maxLength,
+  int overlapping,
+  int canonical,
+  double ** counts,
+  double * totals
+) {
+  return countOligoRangeFrom (
+    sequence, NULL, 0, length, minLength, maxLength, overlapping, canonical,
+    counts, totals
+  );
+}
+
+/**
+ * Count the oligos of every length in a range found in a stretch of packed
+ * nucleotides, in a single pass.
+ *
+ * @public
+ * @param packed The packed nucleotides.
+ * @param start The position of the first nucleotide to use.
+ * @param length The number of nucleotides to use.
+ * @param minLength The length of the shortest oligos.
+ * @param maxLength The length of the longest oligos.
+ * @param overlapping Count every overlapping oligo instead of consecutive
+ *        non-overlapping oligos of each length.
+ * @param canonical Count each oligo at the code of its canonical oligo.
+ * @param counts The array of 4^oligoLength counts to increment for each
+ *        oligo length, starting with minLength.
+ * @param totals The number of oligos counted of each length, starting with
+ *        minLength, is added to this array.
+ * @return The number of oligos counted of every length.
+ */
+size_t countPackedOligoRange (
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  size_t minLength,
+  size_t maxLength,
+  int overlapping,
+  int canonical,
+  double ** counts,
+  double * totals
+) {
+  return countOligoRangeFrom (
+    NULL, packed, start, length, minLength, maxLength, overlapping, canonical,
+    counts, totals
+  );
+}
+
+/**
+ * Spread the count of each oligo that contains an ambiguous nucleotide over
+ * the oligos that are compatible with it, in a stretch of sequence data or
+ * packed nucleotides.
+ *
+ * @private
+ * @param sequence The sequence data, used when packed is NULL.
+ * @param packed The packed nucleotides, or NULL.
+ * @param start The position of the first packed nucleotide to use.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param canonical Count each oligo at the code of its canonical oligo.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of ambiguous oligos spread.
+ */
+static size_t spreadAmbiguousOligosFrom (
+  char * sequence,
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  int canonical,
+  double * counts
+) {
+  char window[KMER_MAX_LENGTH + KMER_BLOCK_LENGTH];
+  char buffer[KMER_BLOCK_LENGTH];
+  char * block;
+  size_t offset, used, blockLength;
+  size_t i, end, total;
+  size_t carry = 0;
+  size_t position = 0;
+  size_t pending = 0;
+  size_t number = 0;
+  if (oligoLength < 1 || oligoLength > KMER_MAX_LENGTH || stepSize < 1) {
+    return 0;
+  }
+  for (offset = 0; offset < length; offset += used) {
+    /* Gather the next block of nucleotides, skipping line breaks, after
+       the end of the previous block. */
+    used = gatherNucleotides (
+      sequence, packed, start + offset, length - offset, buffer,
+      KMER_BLOCK_LENGTH, &block, &blockLength, NULL, NULL
+    );
+    memcpy (window + carry, block, blockLength);
+    /* Visit each oligo that covers an ambiguous nucleotide once, keeping to
+       the oligos that countOligos would have counted. */
+    for (i = 0; i < blockLength; i ++) {
+      if (nucleotideCodes[(unsigned char)window[carry + i]] > 3) {
+        pending = oligoLength;
+      }
+      if (pending == 0) {
+        continue;
+      }
+      pending --;
+      end = position + i + 1;
+      if (end >= oligoLength && (end - oligoLength) % stepSize == 0) {
+        number += spreadOligo (
+          window + carry + i + 1 - oligoLength, oligoLength, canonical, counts
+        );
+      }
+    }
+    position += blockLength;
+    /* Keep the end of the block for the oligos that span blocks. */
+    total = carry + blockLength;
+    carry = total < oligoLength - 1 ? total : oligoLength - 1;
+    memmove (window, window + total - carry, carry);
+  }
+  return number;
+}
+
+/**
+ * Spread the count of each oligo that contains an ambiguous nucleotide over
+ * the oligos that are compatible with it.
+ *
+ * @public
+ * @param sequence The sequence data.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param canonical Count each oligo at the code of its canonical oligo.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of ambiguous oligos spread.
+ */
+size_t spreadAmbiguousOligos (
+  char * sequence,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  int canonical,
+  double * counts
+) {
+  return spreadAmbiguousOligosFrom (
+    sequence, NULL, 0, length, oligoLength, stepSize, canonical, counts
+  );
+}
+
+/**
+ * Spread the count of each oligo that contains an ambiguous nucleotide over
+ * the oligos that are compatible with it, in a stretch of packed
+ * nucleotides.
+ *
+ * @public
+ * @param packed The packed nucleotides.
+ * @param start The position of the first nucleotide to use.
+ * @param length The number of nucleotides to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param canonical Count each oligo at the code of its canonical oligo.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of ambiguous oligos spread.
+ */
+size_t spreadPackedAmbiguousOligos (
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  int canonical,
+  double * counts
+) {
+  return spreadAmbiguousOligosFrom (
+    NULL, packed, start, length, oligoLength, stepSize, canonical, counts
+  );
+}
+
+/**
+ * Calculate the code of the reverse complement of an oligo.
+ *
+ * @public
+ * @param code The code of the oligo.
+ * @param oligoLength The length of the oligo.
+ * @return The code of the reverse complement of the oligo.
+ */
+uint64_t reverseComplementCode (
+  uint64_t code,
+  size_t oligoLength
+) {
+  uint64_t reverse = 0;
+  size_t i;
+  for (i = 0; i < oligoLength; i ++) {
+    reverse = (reverse << 2) | (3 - (code & 3));
+    code >>= 2;
+  }
+  return reverse;
+}
+
+/**
+ * Calculates the number of canonical oligos of the given length.
+ *
+ * @public
+ * @param oligoLength The length of the oligos.
+ * @return The number of canonical oligos.
+ */
+size_t numberCanonicalOligos (
+  size_t oligoLength
+) {
+  size_t palindromes = 0;
+  if (oligoLength % 2 == 0) {
+    palindromes = power (4, oligoLength / 2);
+  }
+  return (power (4, oligoLength) + palindromes) / 2;
+}
+
+/**
+ * Copy the counts of the canonical oligos into consecutive columns, in the
+ * order of their codes.
+ *
+ * @public
+ * @param counts The array of 4^oligoLength counts from countCanonicalOligos.
+ * @param oligoLength The length of the oligos.
+ * @param collapsed The array of numberCanonicalOligos counts to fill.
+ */
+void collapseCanonicalOligos (
+  double * counts,
+  size_t oligoLength,
+  double * collapsed
+) {
+  uint64_t code;
+  uint64_t numCombinations = power (4, oligoLength);
+  size_t column = 0;
+  for (code = 0; code < numCombinations; code ++) {
+    if (code <= reverseComplementCode (code, oligoLength)) {
+      collapsed[column] = counts[code];
+      column ++;
+    }
+  }
+}
+
+/**
+ * Count the oligos found in a stretch of sequence data by comparing each
+ * oligo against every possible nucleotide combination.
+ *
+ * @public
+ * @param sequence The sequence data.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of oligos compared.
+ */
+size_t countOligosReference (
+  char * sequence,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  double * counts
+) {
+  size_t i, l;
+  size_t number = 0;
+  size_t numCombinations;
+  char ** oligonucleotides;
+  char * oligo;
+  if (oligoLength == 0 || stepSize == 0) {
+    return 0;
+  }
+  /* Generate all of the nucleotide combinations. */
+  numCombinations = power (4, oligoLength);
+  oligonucleotides = malloc (numCombinations * sizeof (char *));
+  generateOligonucleotides (oligoLength, oligonucleotides, "", 0);
+  for (i = 0; i + oligoLength <= length; i += stepSize) {
+    /* Compare the oligo generated from the sequence with each possible
+       oligo. */
+    oligo = strndup (sequence + i, oligoLength);
+    for (l = 0; l < numCombinations; l ++) {
+      /* Increment the frequency counter if a match is found in the
+         sequence. */
+      if (sequenceIsEqual (oligo, oligonucleotides[l])) {
+        counts[l] ++;
+      }
+    }
+    free (oligo);
+    number ++;
+  }
+  /* Free the memory used by the oligonucleotides array. */
+  for (l = 0; l < numCombinations; l ++) {
+    free (oligonucleotides[l]);
+  }
+  free (oligonucleotides);
+  return number;
+}
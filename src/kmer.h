@@ -0,0 +1,371 @@
+/*
+ *  Copyright (c) 2014, Jason M. Wood <sandain@hotmail.com>
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Counts the oligonucleotides found in sequence data.
+ *
+ * @file kmer.h
+ */
+
+#ifndef _OLIGO_KMER_H
+#define _OLIGO_KMER_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tools.h"
+
+/**
+ * @def KMER_MAX_LENGTH
+ *   The longest oligo that can be stored in a 64 bit rolling code.
+ */
+#define KMER_MAX_LENGTH 31
+
+/**
+ * @def KMER_BLOCK_LENGTH
+ *   The number of nucleotides encoded at a time while counting.  Must be a
+ *   multiple of 64.
+ */
+#define KMER_BLOCK_LENGTH 4096
+
+/**
+ * @def KMER_AMBIGUOUS_SKIP
+ *   Skip the oligos that contain an ambiguous nucleotide.
+ */
+#define KMER_AMBIGUOUS_SKIP 0
+
+/**
+ * @def KMER_AMBIGUOUS_SPREAD
+ *   Spread a count of one over every oligo compatible with an oligo that
+ *   contains an ambiguous nucleotide.
+ */
+#define KMER_AMBIGUOUS_SPREAD 1
+
+/**
+ * @def KMER_MAX_EXPANSIONS
+ *   The largest number of compatible oligos that the count of an ambiguous
+ *   oligo is spread over.  Oligos with more are skipped.
+ */
+#define KMER_MAX_EXPANSIONS 4096
+
+/**
+ * Generate all of the nucleotide combinations for the given length using a
+ * recursive method.
+ *
+ * @param oligoLength The length of oligonucleotides to generate.
+ * @param oligonucleotides The final list of oligonucleotides generated.
+ * @param oligo The oligo being generated via recursion.
+ * @param index The index of oligonucleotides to store the resulting
+ *        oligonucleotide in.
+ */
+extern void generateOligonucleotides (
+  size_t oligoLength,
+  char ** oligonucleotides,
+  char * oligo,
+  size_t index
+);
+
+/**
+ * Count the oligos found in a stretch of sequence data.
+ *
+ * The sequence data is encoded in blocks with encodeNucleotides, and each
+ * 2 bit code is folded into a rolling code, so every oligo costs a single
+ * increment of counts.  The first nucleotide of
+ * an oligo is stored in the lowest bits of the code, which matches the
+ * order used by generateOligonucleotides.  Oligos that contain a nucleotide
+ * other than A, C, G or T are skipped.  Oligos of length 1 through 8 are
+ * counted by kernels specialized for their length at compile time.
+ *
+ * @param sequence The sequence data.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of oligos counted.
+ */
+extern size_t countOligos (
+  char * sequence,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  double * counts
+);
+
+/**
+ * Count the oligos found in a stretch of packed nucleotides.
+ *
+ * The same as countOligos, but each block of 2 bit codes and its ambiguity
+ * bitmask is taken straight from the packed nucleotides with
+ * encodePackedNucleotides instead of being encoded from characters.
+ *
+ * @param packed The packed nucleotides.
+ * @param start The position of the first nucleotide to use.
+ * @param length The number of nucleotides to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of oligos counted.
+ */
+extern size_t countPackedOligos (
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  double * counts
+);
+
+/**
+ * Count the canonical oligos found in a stretch of sequence data.
+ *
+ * An oligo and its reverse complement are counted as the same oligo, the
+ * canonical oligo, which is the one with the smaller code.  The forward
+ * and reverse complement codes are rolled together in a single pass over
+ * the sequence data, so the reverse complement of the sequence is never
+ * built.  Counts are stored at the code of the canonical oligo, and can be
+ * reduced to one column per canonical oligo with collapseCanonicalOligos.
+ *
+ * @param sequence The sequence data.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of oligos counted.
+ */
+extern size_t countCanonicalOligos (
+  char * sequence,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  double * counts
+);
+
+/**
+ * Count the canonical oligos found in a stretch of packed nucleotides, the
+ * same as countCanonicalOligos.
+ *
+ * @param packed The packed nucleotides.
+ * @param start The position of the first nucleotide to use.
+ * @param length The number of nucleotides to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of oligos counted.
+ */
+extern size_t countPackedCanonicalOligos (
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  double * counts
+);
+
+/**
+ * Count the oligos of every length in a range found in a stretch of
+ * sequence data, in a single pass.
+ *
+ * Only the rolling code of the longest oligo is kept.  The oligos of each
+ * shorter length that end at the same nucleotide are the highest bits of
+ * that code, and their reverse complements are the lowest bits of the
+ * reverse complement code.  Oligos that contain an ambiguous nucleotide are
+ * skipped for each length separately.
+ *
+ * @param sequence The sequence data.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param minLength The length of the shortest oligos.
+ * @param maxLength The length of the longest oligos.
+ * @param overlapping Count every overlapping oligo instead of consecutive
+ *        non-overlapping oligos of each length.
+ * @param canonical Count each oligo at the code of its canonical oligo.
+ * @param counts The array of 4^oligoLength counts to increment for each
+ *        oligo length, starting with minLength.
+ * @param totals The number of oligos counted of each length, starting with
+ *        minLength, is added to this array.
+ * @return The number of oligos counted of every length.
+ */
+extern size_t countOligoRange (
+  char * sequence,
+  size_t length,
+  size_t minLength,
+  size_t maxLength,
+  int overlapping,
+  int canonical,
+  double ** counts,
+  double * totals
+);
+
+/**
+ * Count the oligos of every length in a range found in a stretch of packed
+ * nucleotides, the same as countOligoRange.
+ *
+ * @param packed The packed nucleotides.
+ * @param start The position of the first nucleotide to use.
+ * @param length The number of nucleotides to use.
+ * @param minLength The length of the shortest oligos.
+ * @param maxLength The length of the longest oligos.
+ * @param overlapping Count every overlapping oligo instead of consecutive
+ *        non-overlapping oligos of each length.
+ * @param canonical Count each oligo at the code of its canonical oligo.
+ * @param counts The array of 4^oligoLength counts to increment for each
+ *        oligo length, starting with minLength.
+ * @param totals The number of oligos counted of each length, starting with
+ *        minLength, is added to this array.
+ * @return The number of oligos counted of every length.
+ */
+extern size_t countPackedOligoRange (
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  size_t minLength,
+  size_t maxLength,
+  int overlapping,
+  int canonical,
+  double ** counts,
+  double * totals
+);
+
+/**
+ * Spread the count of each oligo that contains an ambiguous nucleotide over
+ * the oligos that are compatible with it.
+ *
+ * This handles the oligos skipped by countOligos, countCanonicalOligos and
+ * countOligoRange, so counting with one of them and then with this gives
+ * the KMER_AMBIGUOUS_SPREAD policy.  Each IUPAC code is expanded with the
+ * nucleotideMasks table, and every compatible oligo gets an equal share of
+ * a count of one, ie. 1/16 for each oligo compatible with ANNA.  Oligos
+ * that contain a gap or an unrecognized character, or that are compatible
+ * with more than KMER_MAX_EXPANSIONS oligos, are skipped.
+ *
+ * @param sequence The sequence data.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param canonical Count each oligo at the code of its canonical oligo.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of ambiguous oligos spread.
+ */
+extern size_t spreadAmbiguousOligos (
+  char * sequence,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  int canonical,
+  double * counts
+);
+
+/**
+ * Spread the count of each oligo that contains an ambiguous nucleotide over
+ * the oligos that are compatible with it, in a stretch of packed
+ * nucleotides, the same as spreadAmbiguousOligos.  The nucleotides are
+ * unpacked a block at a time, as the ambiguity codes are needed.
+ *
+ * @param packed The packed nucleotides.
+ * @param start The position of the first nucleotide to use.
+ * @param length The number of nucleotides to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param canonical Count each oligo at the code of its canonical oligo.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of ambiguous oligos spread.
+ */
+extern size_t spreadPackedAmbiguousOligos (
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  int canonical,
+  double * counts
+);
+
+/**
+ * Calculate the code of the reverse complement of an oligo.
+ *
+ * @param code The code of the oligo.
+ * @param oligoLength The length of the oligo.
+ * @return The code of the reverse complement of the oligo.
+ */
+extern uint64_t reverseComplementCode (
+  uint64_t code,
+  size_t oligoLength
+);
+
+/**
+ * Calculates the number of canonical oligos of the given length, which is
+ * (4^oligoLength + 4^(oligoLength / 2)) / 2 for even lengths, where the
+ * palindromes are their own reverse complement, and 4^oligoLength / 2 for
+ * odd lengths.
+ *
+ * @param oligoLength The length of the oligos.
+ * @return The number of canonical oligos.
+ */
+extern size_t numberCanonicalOligos (
+  size_t oligoLength
+);
+
+/**
+ * Copy the counts of the canonical oligos into consecutive columns, in the
+ * order of their codes.
+ *
+ * @param counts The array of 4^oligoLength counts from countCanonicalOligos.
+ * @param oligoLength The length of the oligos.
+ * @param collapsed The array of numberCanonicalOligos counts to fill.
+ */
+extern void collapseCanonicalOligos (
+  double * counts,
+  size_t oligoLength,
+  double * collapsed
+);
+
+/**
+ * Count the oligos found in a stretch of sequence data by comparing each
+ * oligo against every possible nucleotide combination.
+ *
+ * This is the original string based method, kept to validate countOligos.
+ * Ambiguous nucleotides are resolved with sequenceIsEqual, so an oligo
+ * containing an IUPAC code increments every combination that it matches.
+ *
+ * @param sequence The sequence data.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param oligoLength The length of the oligos.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @param counts The array of 4^oligoLength counts to increment.
+ * @return The number of oligos compared.
+ */
+extern size_t countOligosReference (
+  char * sequence,
+  size_t length,
+  size_t oligoLength,
+  size_t stepSize,
+  double * counts
+);
+
+#endif
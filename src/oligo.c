@@ -37,15 +37,22 @@
  *
  */
 
+#include <getopt.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
 #include <time.h>
+#ifdef _OPENMP
 #include <omp.h>
+#endif
 
 #include "cluster.h"
 #include "fasta.h"
+#include "kmer.h"
+#include "profile.h"
 #include "sequence.h"
 #include "tools.h"
 
@@ -69,19 +76,167 @@
  */
 #define DEFAULT_FRAGMENT_LENGTH 5000
 
-void generateOligonucleotides (
+/**
+ * The structure to hold the parameters used to calculate the oligo usage
+ * frequency.
+ */
+typedef struct Parameters {
+  size_t minLength;                /**< The length of the shortest oligos. */
+  size_t oligoLength;              /**< The length of the longest oligos. */
+  size_t fragmentLength;           /**< The length of the fragments. */
+  size_t numCombinations;          /**< The number of columns per sequence. */
+  int overlapping;                 /**< Count every overlapping oligo. */
+  int canonical;                   /**< Merge reverse complement oligos. */
+  int sparse;                      /**< Count oligos in sparse profiles. */
+  int ambiguous;                   /**< The ambiguous oligo policy. */
+  int quality;                     /**< The minimum nucleotide quality. */
+  int genome;                      /**< Use a single row for each file. */
+  uint64_t seed;                   /**< The seed of the fragment sampling. */
+} Parameters;
+
+/**
+ * The structure to hold the rows of the frequency matrix counted from a
+ * single fasta file.
+ */
+typedef struct FileRows {
+  size_t size;                     /**< The number of rows. */
+  size_t capacity;                 /**< The room for rows. */
+  char ** ids;                     /**< The identifier of each row. */
+  double * frequency;              /**< The rows of the frequency matrix. */
+  Profile ** profiles;             /**< The sparse profile of each row. */
+} FileRows;
+
+/**
+ * The structure to hold the fragments of a sequence to count oligos in.
+ * Each thread keeps its own, which grows to fit the sequence with the most
+ * fragments.
+ */
+typedef struct Fragments {
+  size_t * starts;                 /**< The start of each fragment. */
+  size_t * lengths;                /**< The length of each fragment. */
+  size_t capacity;                 /**< The room for fragments. */
+} Fragments;
+
+/**
+ * The command line options understood by Oligo.
+ */
+static struct option longOptions[] = {
+  {"ambiguous",   required_argument, NULL, 'a'},
+  {"canonical",   no_argument,       NULL, 'c'},
+  {"genome",      no_argument,       NULL, 'g'},
+  {"help",        no_argument,       NULL, 'h'},
+  {"list",        required_argument, NULL, 'l'},
+  {"overlapping", no_argument,       NULL, 'o'},
+  {"quality",     required_argument, NULL, 'q'},
+  {"seed",        required_argument, NULL, 's'},
+  {"sparse",      no_argument,       NULL, 'S'},
+  {"threads",     required_argument, NULL, 't'},
+  {NULL,          0,                 NULL, 0}
+};
+
+void usage (
+  char * program
+);
+
+int isLength (
+  char * argument
+);
+
+char ** addInput (
+  char ** files,
+  size_t * numFiles,
+  char * path
+);
+
+char ** addInputList (
+  char ** files,
+  size_t * numFiles,
+  FILE * list
+);
+
+size_t numberColumns (
   size_t oligoLength,
-  char ** oligonucleotides,
-  char * oligo,
-  size_t index
+  int canonical
+);
+
+size_t scratchLength (
+  Parameters * parameters
+);
+
+size_t sequenceFragments (
+  size_t sequenceLength,
+  size_t index,
+  Parameters * parameters,
+  size_t * starts,
+  size_t * lengths
+);
+
+size_t chooseFragments (
+  Sequence * seq,
+  size_t index,
+  Fragments * fragments,
+  Parameters * parameters
+);
+
+double sequenceFrequency (
+  Sequence * seq,
+  size_t index,
+  double * frequency,
+  double * counts,
+  Fragments * fragments,
+  Parameters * parameters
+);
+
+void countSequence (
+  Sequence * seq,
+  size_t index,
+  double * frequency,
+  double * counts,
+  double * totals,
+  Fragments * fragments,
+  Parameters * parameters
+);
+
+double normalizeFrequency (
+  double * frequency,
+  double * counts,
+  double * totals,
+  Parameters * parameters
+);
+
+void sequenceProfile (
+  Sequence * seq,
+  size_t index,
+  Profile * profile,
+  Fragments * fragments,
+  Parameters * parameters
 );
 
 double * oligoFrequency (
   Fasta * fasta,
+  size_t * numSequences,
+  Parameters * parameters
+);
+
+double * profileFrequency (
+  Profile ** profiles,
   size_t numSequences,
-  size_t numCombinations,
-  size_t oligoLength,
-  size_t fragmentLength
+  Parameters * parameters
+);
+
+double * fileFrequency (
+  char ** files,
+  size_t numFiles,
+  size_t * numSequences,
+  char *** ids,
+  Parameters * parameters
+);
+
+int nextFileSequence (
+  Fasta * fasta,
+  Sequence * seq,
+  char * fileName,
+  int * error
 );
 
 /**
@@ -95,66 +250,215 @@ int main (
   int argc,
   char * argv[]
 ) {
-  size_t oligoLength;
-  size_t fragmentLength;
+  Parameters parameters;
   size_t numSequences;
   size_t numCombinations;
-  size_t i;
+  size_t k;
   double * frequency;
   char ** ids;
-  char * fastaFile;
-  /* Grab the fasta file from the command line, or produce an error. */
-  if (argc < 2) {
+  char ** files = NULL;
+  size_t numFiles = 0;
+  size_t i;
+  char * listFile = NULL;
+  FILE * list;
+  Fasta * fasta = NULL;
+  int threads = 0;
+  int last;
+  int option;
+  int seedSupplied = 0;
+  /* Initialize the parameters. */
+  parameters.overlapping = 0;
+  parameters.canonical = 0;
+  parameters.sparse = 0;
+  parameters.ambiguous = KMER_AMBIGUOUS_SKIP;
+  parameters.quality = 0;
+  parameters.genome = 0;
+  parameters.seed = time (NULL);
+  /* Grab the options from the command line. */
+  while (
+    (option = getopt_long (
+      argc, argv, "a:cghl:oq:s:St:", longOptions, NULL
+    )) != -1
+  ) {
+    switch (option) {
+      case 'a' : if (strcmp (optarg, "skip") == 0) {
+                   parameters.ambiguous = KMER_AMBIGUOUS_SKIP;
+                 }
+                 else if (strcmp (optarg, "spread") == 0) {
+                   parameters.ambiguous = KMER_AMBIGUOUS_SPREAD;
+                 }
+                 else {
+                   printf ("Error, invalid ambiguous policy: %s\n", optarg);
+                   return 1;
+                 }
+                 break;
+      case 'c' : parameters.canonical = 1;
+                 break;
+      case 'g' : parameters.genome = 1;
+                 break;
+      case 'h' : usage (argv[0]);
+                 return 0;
+      case 'l' : listFile = optarg;
+                 break;
+      case 'o' : parameters.overlapping = 1;
+                 break;
+      case 'q' : parameters.quality = atoi (optarg);
+                 if (parameters.quality < 0) {
+                   printf ("Error, invalid minimum quality: %s\n", optarg);
+                   return 1;
+                 }
+                 break;
+      case 's' : parameters.seed = strtoull (optarg, NULL, 10);
+                 seedSupplied = 1;
+                 break;
+      case 'S' : parameters.sparse = 1;
+                 break;
+      case 't' : threads = atoi (optarg);
+                 if (threads < 1) {
+                   printf ("Error, invalid number of threads: %s\n", optarg);
+                   return 1;
+                 }
+                 break;
+      default  : usage (argv[0]);
+                 return 1;
+    }
+  }
+  /* The oligo length and fragment length are the numbers at the end of the
+     command line, after the fasta files. */
+  last = argc;
+  while (last > optind && argc - last < 2 && isLength (argv[last - 1])) {
+    last --;
+  }
+  /* Grab the fasta files and directories from the command line and the
+     list file, or produce an error. */
+  for (i = optind; i < (size_t)last; i ++) {
+    files = addInput (files, &numFiles, argv[i]);
+  }
+  if (listFile != NULL) {
+    list = fopen (listFile, "r");
+    if (list == NULL) {
+      printf ("Error, unable to read list file %s!\n", listFile);
+      return 1;
+    }
+    files = addInputList (files, &numFiles, list);
+    fclose (list);
+  }
+  if (numFiles == 0) {
     printf ("Error, fasta formatted sequence file not provided!\n");
+    usage (argv[0]);
     return 1;
   }
-  fastaFile = strdup (argv[1]);
   /* Grab the oligo length from the command line, or use the default value if
      not provided. */
-  if (argc >= 3) {
-    oligoLength = atoi (argv[2]);
+  if (argc - last >= 1) {
+    char * end;
+    parameters.minLength = strtoul (argv[last], &end, 10);
+    parameters.oligoLength = parameters.minLength;
+    /* A range of oligo lengths is given as min-max. */
+    if (*end == '-') {
+      parameters.oligoLength = strtoul (end + 1, &end, 10);
+    }
+    if (
+      *end != '\0' || parameters.minLength < 1 ||
+      parameters.minLength > parameters.oligoLength ||
+      parameters.oligoLength > KMER_MAX_LENGTH
+    ) {
+      printf ("Error, invalid oligo length: %s\n", argv[last]);
+      return 1;
+    }
   }
   else {
     printf (
       "Oligo length parameter not supplied, using default value of %d.\n",
       DEFAULT_OLIGO_LENGTH
     );
-    oligoLength = DEFAULT_OLIGO_LENGTH;
+    parameters.minLength = DEFAULT_OLIGO_LENGTH;
+    parameters.oligoLength = DEFAULT_OLIGO_LENGTH;
   }
   /* Grab the fragment length from the command line, or use the default value
      if not provided. */
-  if (argc >= 4) {
-    fragmentLength = atoi (argv[3]);
+  if (argc - last >= 2) {
+    parameters.fragmentLength = atoi (argv[last + 1]);
   }
   else {
     printf (
       "Fragment length parameter not supplied, using default value of %d.\n",
       DEFAULT_FRAGMENT_LENGTH
     );
-    fragmentLength = DEFAULT_FRAGMENT_LENGTH;
+    parameters.fragmentLength = DEFAULT_FRAGMENT_LENGTH;
+  }
+  if (parameters.sparse && parameters.minLength < parameters.oligoLength) {
+    printf ("Error, sparse profiles require a single oligo length.\n");
+    return 1;
+  }
+  if (parameters.sparse && parameters.ambiguous == KMER_AMBIGUOUS_SPREAD) {
+    printf ("Error, sparse profiles can not spread ambiguous oligos.\n");
+    return 1;
+  }
+  /* Report the random seed so that a run can be reproduced. */
+  if (! parameters.overlapping && ! seedSupplied) {
+    printf (
+      "Random seed not supplied, using value of %llu.\n",
+      (unsigned long long)parameters.seed
+    );
+  }
+  /* Set the number of threads used to calculate the oligo usage
+     frequency. */
+#ifdef _OPENMP
+  if (threads > 0) {
+    omp_set_num_threads (threads);
+  }
+#endif
+  /* Load a single fasta file, which is counted a sequence at a time on each
+     thread.  Several fasta files are counted a file at a time on each
+     thread instead. */
+  if (numFiles == 1 && ! parameters.genome) {
+    fasta = newFasta (files[0]);
+    if (fasta == NULL) {
+      printf ("Error, unable to load fasta file %s!\n", files[0]);
+      return 1;
+    }
+    setMinimumLength (fasta, parameters.fragmentLength);
+    setMinimumQuality (fasta, parameters.quality);
   }
-  /* Load the fasta file. */
-  Fasta * fasta = newFasta (fastaFile);
-  setMinimumLength (fasta, fragmentLength);
-  numSequences = numberSequences (fasta);
-  ids = getIdentifiers (fasta);
 
   // XXX Use the fasta object throughout.  Requires the fasta object to be smarter.
 
-  /* Determine the number of nucleotide combinations. */
-  numCombinations = power (4, oligoLength);
+  /* Determine the number of nucleotide combinations, over every oligo
+     length used. */
+  numCombinations = 0;
+  for (k = parameters.minLength; k <= parameters.oligoLength; k ++) {
+    numCombinations += numberColumns (k, parameters.canonical);
+  }
+  parameters.numCombinations = numCombinations;
   /* Generate the oligonucleotide usage frequency matrix. */
   printf ("Generating the oligo usage frequency matrix.\n");
-  frequency = oligoFrequency (
-    fasta, numSequences, numCombinations, oligoLength, fragmentLength
-  );
+  if (fasta != NULL) {
+    frequency = oligoFrequency (fasta, &numSequences, &parameters);
+    if (frequency == NULL) {
+      freeFasta (fasta);
+      return 1;
+    }
+    /* The sequences of a fasta file read as a stream are only known once
+       the stream has been read. */
+    ids = getIdentifiers (fasta);
+  }
+  else {
+    frequency = fileFrequency (
+      files, numFiles, &numSequences, &ids, &parameters
+    );
+    if (frequency == NULL) {
+      return 1;
+    }
+  }
+  numCombinations = parameters.numCombinations;
   /* Display the oligonucleotide usage frequency matrix if debug is on. */
   if (DEBUG > 0) {
     size_t s, c;
     for (s = 0; s < numSequences; s ++) {
       printf ("%s: ", ids[s]);
       for (c = 0; c < numCombinations; c ++) {
-        printf ("%.4f ", frequency[s + c * numCombinations]);
+        printf ("%.4f ", frequency[s * numCombinations + c]);
       }
       printf ("\n");
     }
@@ -171,146 +475,1039 @@ int main (
 
 
   /* Free reserved memory. */
+  if (fasta != NULL) {
+    freeFasta (fasta);
+  }
+  else {
+    for (i = 0; i < numSequences; i ++) {
+      free (ids[i]);
+    }
+  }
   free (ids);
-  freeFasta (fasta);
+  for (i = 0; i < numFiles; i ++) {
+    free (files[i]);
+  }
+  free (files);
   free (frequency);
   return 0;
 }
 
 /**
- * Generate all of the nucleotide combinations for the given length using a
- * recursive method.
- * 
- * @param oligoLength The length of oligonucleotides to generate.
- * @param oligonucleotides The final list of oligonucleotides generated.
- * @param oligo The oligo being generated via recursion.
- * @param index The index of oligonucleotides to store the resulting
- *        oligonucleotide in.
+ * Display the usage information for the Oligo program.
+ *
+ * @param program The name of the program.
+ */
+void usage (
+  char * program
+) {
+  printf (
+    "Usage: %s [options] fasta... [oligoLength] [fragmentLength]\n"
+    "\n"
+    "Each fasta may be a fasta file or a directory of fasta files.  The\n"
+    "frequency matrix has a row for each sequence of every file, or for\n"
+    "each file with --genome.  Name a fasta file made only of digits as\n"
+    "./name, so that it is not taken for a length.\n"
+    "\n"
+    "The oligoLength may be a range of lengths, such as 1-6, to calculate\n"
+    "the oligo usage frequency of every length in the range at once.  The\n"
+    "columns of each length are normalized separately.\n"
+    "\n"
+    "The fasta file may be gzip compressed.  BGZF files, such as those\n"
+    "written by bgzip, are indexed for random access.  FASTQ files are\n"
+    "recognized by the '@' at their start.  Use - as the fasta file to\n"
+    "read standard input, or give a pipe, to read the sequences as a\n"
+    "stream in a single pass.  UCSC .2bit files are read directly,\n"
+    "without converting them to fasta.\n"
+    "\n"
+    "Options:\n"
+    "  -a, --ambiguous P  How to count oligos that contain an ambiguous\n"
+    "                     nucleotide: skip them (the default), or spread\n"
+    "                     a count of one over every compatible oligo.\n"
+    "  -c, --canonical    Count each oligo and its reverse complement as\n"
+    "                     the same oligo.\n"
+    "  -g, --genome       Count all of the sequences of each fasta file\n"
+    "                     into a single row named after the file.\n"
+    "  -h, --help         Display this help message.\n"
+    "  -l, --list FILE    Read more fasta files and directories from FILE,\n"
+    "                     one on each line.\n"
+    "  -o, --overlapping  Count every overlapping oligo in each sequence\n"
+    "                     instead of sampling random fragments.\n"
+    "  -q, --quality N    Replace the nucleotides of a FASTQ file that\n"
+    "                     have a quality below N with N.\n"
+    "  -s, --seed N       Seed the random fragment sampling with N.\n"
+    "  -S, --sparse       Count the oligos of each sequence in a sparse\n"
+    "                     profile, and only keep the oligos that were\n"
+    "                     found in the frequency matrix.  Use this with\n"
+    "                     long oligos.\n"
+    "  -t, --threads N    Use N threads to calculate the oligo usage\n"
+    "                     frequency.\n",
+    program
+  );
+}
+
+/**
+ * Checks if a command line argument is an oligo length or fragment length,
+ * a number or a range of numbers.
+ *
+ * @param argument The command line argument.
+ * @return True if the argument is a length.
+ */
+int isLength (
+  char * argument
+) {
+  return isdigit ((unsigned char)argument[0]) &&
+    strspn (argument, "0123456789-") == strlen (argument);
+}
+
+/**
+ * Add a fasta file, or the fasta files in a directory, to the list of
+ * files to count.
+ *
+ * The files in a directory are added in name order, leaving out hidden
+ * files, index files and anything that is not a regular file.
+ *
+ * @param files The list of files.
+ * @param numFiles The number of files in the list, which is updated.
+ * @param path The fasta file or directory.
+ * @return The list of files.
+ */
+char ** addInput (
+  char ** files,
+  size_t * numFiles,
+  char * path
+) {
+  struct dirent ** entries;
+  struct stat fileStat;
+  char * name;
+  size_t length;
+  int number, i;
+  if (stat (path, &fileStat) != 0 || ! S_ISDIR (fileStat.st_mode)) {
+    files = realloc (files, (*numFiles + 1) * sizeof (char *));
+    files[*numFiles] = strdup (path);
+    (*numFiles) ++;
+    return files;
+  }
+  number = scandir (path, &entries, NULL, alphasort);
+  for (i = 0; i < number; i ++) {
+    length = strlen (entries[i]->d_name);
+    name = malloc ((strlen (path) + length + 2) * sizeof (char));
+    sprintf (name, "%s/%s", path, entries[i]->d_name);
+    if (
+      entries[i]->d_name[0] != '.' &&
+      ! (length > 4 && strcmp (entries[i]->d_name + length - 4, ".fai") == 0) &&
+      ! (length > 4 && strcmp (entries[i]->d_name + length - 4, ".gzi") == 0) &&
+      stat (name, &fileStat) == 0 && S_ISREG (fileStat.st_mode)
+    ) {
+      files = realloc (files, (*numFiles + 1) * sizeof (char *));
+      files[*numFiles] = name;
+      (*numFiles) ++;
+    }
+    else {
+      free (name);
+    }
+    free (entries[i]);
+  }
+  if (number >= 0) {
+    free (entries);
+  }
+  return files;
+}
+
+/**
+ * Add the fasta files and directories in a list file to the list of files
+ * to count, one on each line.  Empty lines are skipped.
+ *
+ * @param files The list of files.
+ * @param numFiles The number of files in the list, which is updated.
+ * @param list The list file.
+ * @return The list of files.
+ */
+char ** addInputList (
+  char ** files,
+  size_t * numFiles,
+  FILE * list
+) {
+  char * line = NULL;
+  size_t lineSize = 0;
+  while (getline (&line, &lineSize, list) >= 0) {
+    chomp (line);
+    if (line[0] != '\0') {
+      files = addInput (files, numFiles, line);
+    }
+  }
+  free (line);
+  return files;
+}
+
+/**
+ * Calculates the number of columns used for oligos of a given length.
+ *
+ * @param oligoLength The length of the oligos.
+ * @param canonical Count each oligo and its reverse complement as the same
+ *        oligo.
+ * @return The number of columns.
  */
-void generateOligonucleotides (
+size_t numberColumns (
   size_t oligoLength,
-  char ** oligonucleotides,
-  char * oligo,
-  size_t index
+  int canonical
 ) {
-  char nucs[4] = {'a', 'c', 'g', 't'};
-  size_t i;
-  size_t length = strlen(oligo);
-  /* If oligo is not long enough, append the four nucleotides to oligo and
-     recurse. If oligo is long enough, push the oligo onto the
-     oligonucleotides array and return. */
-  if (oligoLength > length) {
-    /* Make a local copy of the oligo. */
-    char buffer[oligoLength + 1];
-    strcpy (buffer, oligo);
-    for (i = 0; i < 4; i ++) {
-      buffer[length] = nucs[i];
-      buffer[length + 1] = '\0';
-      generateOligonucleotides (
-        oligoLength, oligonucleotides, buffer, index + i * pow(4, length)
+  if (canonical) {
+    return numberCanonicalOligos (oligoLength);
+  }
+  return power (4, oligoLength);
+}
+
+/**
+ * Calculates the number of counts each thread needs to count canonical
+ * oligos, one 4^oligoLength array for each oligo length used.
+ *
+ * @param parameters The parameters used to calculate the frequency.
+ * @return The number of counts, or 0 if none are needed.
+ */
+size_t scratchLength (
+  Parameters * parameters
+) {
+  size_t k;
+  size_t length = 0;
+  if (! parameters->canonical || parameters->sparse) {
+    return 0;
+  }
+  for (k = parameters->minLength; k <= parameters->oligoLength; k ++) {
+    length += power (4, k);
+  }
+  return length;
+}
+
+/**
+ * Choose the fragments of a sequence to count oligos in.
+ *
+ * When counting overlapping oligos the whole sequence is used as a single
+ * fragment.  Otherwise about 1.5 * sequenceLength / fragmentLength random
+ * fragments are chosen, one from each of a series of evenly spaced windows.
+ * The random fragments of a sequence are drawn from the stream of random
+ * numbers selected by the index of the sequence, so a sequence is always
+ * sampled the same way for a given seed.
+ *
+ * @param sequenceLength The length of the sequence.
+ * @param index The index of the sequence.
+ * @param parameters The parameters used to calculate the frequency.
+ * @param starts The start of each fragment, or NULL to only count the
+ *        fragments.
+ * @param lengths The length of each fragment, or NULL to only count the
+ *        fragments.
+ * @return The number of fragments.
+ */
+size_t sequenceFragments (
+  size_t sequenceLength,
+  size_t index,
+  Parameters * parameters,
+  size_t * starts,
+  size_t * lengths
+) {
+  size_t j;
+  size_t numSamples;
+  size_t stepSize;
+  size_t sampleLength;
+  size_t fragmentLength = parameters->fragmentLength;
+  size_t r;
+  /* Use every overlapping oligo in the sequence. */
+  if (parameters->overlapping) {
+    if (starts != NULL) {
+      starts[0] = 0;
+      lengths[0] = sequenceLength;
+    }
+    return 1;
+  }
+  /* Take samples from the sequence, and average the nucleotide usage of
+     the samples. */
+  numSamples = rint (
+    (1.5 * sequenceLength) / (1.0 * fragmentLength)
+  );
+  if (starts == NULL) {
+    return numSamples;
+  }
+  stepSize = rint (
+    (sequenceLength - fragmentLength) / (1.0 * numSamples)
+  );
+  for (j = 0; j < numSamples; j ++) {
+    /* Take a random sample of a section of the sequence. */
+    r = j * stepSize;
+    if (stepSize > 0) {
+      r += randomNumber (parameters->seed, index, j) % stepSize;
+    }
+    if (r >= sequenceLength) {
+      break;
+    }
+    sampleLength = sequenceLength - r;
+    if (sampleLength > fragmentLength) {
+      sampleLength = fragmentLength;
+    }
+    starts[j] = r;
+    lengths[j] = sampleLength;
+  }
+  return j;
+}
+
+/**
+ * Choose the fragments of a sequence to count oligos in (see
+ * sequenceFragments), growing the fragments to fit them.
+ *
+ * @param seq The sequence.
+ * @param index The index of the sequence.
+ * @param fragments The fragments of the sequence.
+ * @param parameters The parameters used to calculate the frequency.
+ * @return The number of fragments.
+ */
+size_t chooseFragments (
+  Sequence * seq,
+  size_t index,
+  Fragments * fragments,
+  Parameters * parameters
+) {
+  size_t numFragments = sequenceFragments (
+    getSequenceLength (seq), index, parameters, NULL, NULL
+  );
+  if (numFragments + 1 > fragments->capacity) {
+    fragments->capacity = numFragments + 1;
+    fragments->starts = realloc (
+      fragments->starts, fragments->capacity * sizeof (size_t)
+    );
+    fragments->lengths = realloc (
+      fragments->lengths, fragments->capacity * sizeof (size_t)
+    );
+  }
+  return sequenceFragments (
+    getSequenceLength (seq), index, parameters, fragments->starts,
+    fragments->lengths
+  );
+}
+
+/**
+ * Calculate the oligo usage frequency of a single sequence.
+ *
+ * The row holds the columns of each oligo length in turn, starting with
+ * the shortest, and each length is normalized by the number of oligos of
+ * that length counted.  The row must be zeroed by the caller.
+ *
+ * @param seq The sequence.
+ * @param index The index of the sequence.
+ * @param frequency The row of the frequency matrix for the sequence.
+ * @param counts The scratchLength counts used to count canonical oligos.
+ * @param fragments The fragments used to choose where to count oligos.
+ * @param parameters The parameters used to calculate the frequency.
+ * @return The number of oligos counted.
+ */
+double sequenceFrequency (
+  Sequence * seq,
+  size_t index,
+  double * frequency,
+  double * counts,
+  Fragments * fragments,
+  Parameters * parameters
+) {
+  double totals[KMER_MAX_LENGTH + 1] = {0};
+  if (parameters->canonical) {
+    memset (counts, 0, scratchLength (parameters) * sizeof (double));
+  }
+  countSequence (
+    seq, index, frequency, counts, totals, fragments, parameters
+  );
+  return normalizeFrequency (frequency, counts, totals, parameters);
+}
+
+/**
+ * Count the oligos of a single sequence, adding to the counts of the
+ * sequences counted before it.
+ *
+ * A single oligo length is counted with countOligos or
+ * countCanonicalOligos, while a range of lengths is counted in one pass
+ * with countOligoRange.  With the KMER_AMBIGUOUS_SPREAD policy, the oligos
+ * that contain an ambiguous nucleotide are then spread with
+ * spreadAmbiguousOligos.  Canonical oligos are counted at the code of the
+ * canonical oligo in counts, and collapsed into the row by
+ * normalizeFrequency.
+ *
+ * @param seq The sequence.
+ * @param index The index of the sequence.
+ * @param frequency The row of the frequency matrix to count oligos in.
+ * @param counts The scratchLength counts used to count canonical oligos.
+ * @param totals The number of oligos counted of each length, from the
+ *        shortest length.
+ * @param fragments The fragments used to choose where to count oligos.
+ * @param parameters The parameters used to calculate the frequency.
+ */
+void countSequence (
+  Sequence * seq,
+  size_t index,
+  double * frequency,
+  double * counts,
+  double * totals,
+  Fragments * fragments,
+  Parameters * parameters
+) {
+  size_t j, k;
+  size_t numFragments;
+  size_t * starts;
+  size_t * lengths;
+  size_t column, offset;
+  size_t bytes;
+  size_t minLength = parameters->minLength;
+  size_t oligoLength = parameters->oligoLength;
+  size_t stepSize = parameters->overlapping ? 1 : oligoLength;
+  double * blocks[KMER_MAX_LENGTH + 1];
+  char * data;
+  PackedNucleotides * packed = getPackedSequence (seq);
+  size_t (*count) (char *, size_t, size_t, size_t, double *) = countOligos;
+  size_t (*countPacked) (
+    PackedNucleotides *, size_t, size_t, size_t, size_t, double *
+  ) = countPackedOligos;
+  /* Choose the fragments of the sequence to count oligos in. */
+  numFragments = chooseFragments (seq, index, fragments, parameters);
+  starts = fragments->starts;
+  lengths = fragments->lengths;
+  /* Find where the counts of each oligo length go. */
+  if (parameters->canonical) {
+    count = countCanonicalOligos;
+    countPacked = countPackedCanonicalOligos;
+  }
+  offset = 0;
+  column = 0;
+  for (k = minLength; k <= oligoLength; k ++) {
+    if (parameters->canonical) {
+      blocks[k - minLength] = counts + offset;
+    }
+    else {
+      blocks[k - minLength] = frequency + column;
+    }
+    offset += power (4, k);
+    column += numberColumns (k, parameters->canonical);
+  }
+  /* Count the oligos in each fragment, reading the sequence data in place
+     even when it is broken into lines, or straight from the packed
+     sequence data. */
+  for (j = 0; j < numFragments; j ++) {
+    if (packed != NULL) {
+      if (minLength == oligoLength) {
+        totals[0] += countPacked (
+          packed, starts[j], lengths[j], oligoLength, stepSize, blocks[0]
+        );
+      }
+      else {
+        countPackedOligoRange (
+          packed, starts[j], lengths[j], minLength, oligoLength,
+          parameters->overlapping, parameters->canonical, blocks, totals
+        );
+      }
+      if (parameters->ambiguous == KMER_AMBIGUOUS_SPREAD) {
+        for (k = minLength; k <= oligoLength; k ++) {
+          totals[k - minLength] += spreadPackedAmbiguousOligos (
+            packed, starts[j], lengths[j], k,
+            parameters->overlapping ? 1 : k, parameters->canonical,
+            blocks[k - minLength]
+          );
+        }
+      }
+      continue;
+    }
+    data = getSequenceRange (seq, starts[j], lengths[j], &bytes);
+    if (minLength == oligoLength) {
+      totals[0] += count (data, bytes, oligoLength, stepSize, blocks[0]);
+    }
+    else {
+      countOligoRange (
+        data, bytes, minLength, oligoLength, parameters->overlapping,
+        parameters->canonical, blocks, totals
       );
     }
+    /* Spread the ambiguous oligos skipped above over the oligos they are
+       compatible with. */
+    if (parameters->ambiguous == KMER_AMBIGUOUS_SPREAD) {
+      for (k = minLength; k <= oligoLength; k ++) {
+        totals[k - minLength] += spreadAmbiguousOligos (
+          data, bytes, k, parameters->overlapping ? 1 : k,
+          parameters->canonical, blocks[k - minLength]
+        );
+      }
+    }
   }
-  else {
-    oligonucleotides[index] = strdup (oligo);
+}
+
+/**
+ * Turn the oligo counts of a row into the oligo usage frequency.
+ *
+ * The canonical oligo counts are collapsed into the row first.  The
+ * columns of each oligo length are then normalized by the number of oligos
+ * of that length counted.
+ *
+ * @param frequency The row of the frequency matrix.
+ * @param counts The scratchLength counts used to count canonical oligos.
+ * @param totals The number of oligos counted of each length, from the
+ *        shortest length.
+ * @param parameters The parameters used to calculate the frequency.
+ * @return The number of oligos counted.
+ */
+double normalizeFrequency (
+  double * frequency,
+  double * counts,
+  double * totals,
+  Parameters * parameters
+) {
+  size_t j, k;
+  size_t column = 0;
+  size_t offset = 0;
+  size_t minLength = parameters->minLength;
+  double total = 0.0;
+  for (k = minLength; k <= parameters->oligoLength; k ++) {
+    size_t numColumns = numberColumns (k, parameters->canonical);
+    if (parameters->canonical) {
+      collapseCanonicalOligos (counts + offset, k, frequency + column);
+    }
+    if (totals[k - minLength] > 0.0) {
+      for (j = column; j < column + numColumns; j ++) {
+        frequency[j] /= totals[k - minLength];
+      }
+    }
+    total += totals[k - minLength];
+    offset += power (4, k);
+    column += numColumns;
+  }
+  return total;
+}
+
+/**
+ * Count the oligos of a single sequence in a sparse profile.
+ *
+ * The profile is left unsorted, so that the oligos of more sequences can
+ * be counted in it.
+ *
+ * @param seq The sequence.
+ * @param index The index of the sequence.
+ * @param profile The profile to count the oligos in.
+ * @param fragments The fragments used to choose where to count oligos.
+ * @param parameters The parameters used to calculate the frequency.
+ */
+void sequenceProfile (
+  Sequence * seq,
+  size_t index,
+  Profile * profile,
+  Fragments * fragments,
+  Parameters * parameters
+) {
+  size_t j;
+  size_t numFragments;
+  size_t * starts;
+  size_t * lengths;
+  size_t stepSize = parameters->overlapping ? 1 : parameters->oligoLength;
+  size_t bytes;
+  char * data;
+  PackedNucleotides * packed = getPackedSequence (seq);
+  /* Choose the fragments of the sequence to count oligos in. */
+  numFragments = chooseFragments (seq, index, fragments, parameters);
+  starts = fragments->starts;
+  lengths = fragments->lengths;
+  for (j = 0; j < numFragments; j ++) {
+    if (packed != NULL) {
+      countPackedProfileOligos (
+        profile, packed, starts[j], lengths[j], stepSize
+      );
+      continue;
+    }
+    data = getSequenceRange (seq, starts[j], lengths[j], &bytes);
+    countProfileOligos (profile, data, bytes, stepSize);
   }
 }
 
 /**
  * Calculate the oligo usage frequency for each sequence in a fasta file.
  *
+ * Sequences are handed out to the threads one at a time as each thread
+ * finishes its previous sequence.  Only the index of the sequence is
+ * handed out in the critical section, and each thread reads its sequence
+ * with positional reads of its own.  A fasta file read as a stream, or
+ * without positional reads such as a BGZF file, is read in order in the
+ * critical section instead.  Each thread counts its sequence into a
+ * row of its own, and stores the row in the matrix at the index of the
+ * sequence in a short critical section, which also makes room in the
+ * matrix for the sequences of a fasta file read as a stream.  The matrix
+ * is identical no matter how many threads are used.
+ *
+ * When counting sparse profiles, the matrix only has columns for the oligos
+ * found in at least one sequence, and is built once every profile has been
+ * counted.  The number of columns is stored in parameters.
+ *
  * @param fasta The fasta object.
- * @param numSequences The number of sequences.
- * @param oligoLength - The length of the oligos.
- * @param fragmentLength - The minimum length of sequences to use.
- * @param numCombinations - The number of possible oligo combinations.
- * @return The oligo frequency matrix generated.
+ * @param numSequences Set to the number of sequences.
+ * @param parameters The parameters used to calculate the frequency.
+ * @return The oligo frequency matrix generated, or NULL if a sequence can
+ *         not be read.
  */
 double * oligoFrequency (
   Fasta * fasta,
+  size_t * numSequences,
+  Parameters * parameters
+) {
+  size_t next = 0;
+  size_t capacity = numberSequences (fasta);
+  size_t numCombinations = parameters->numCombinations;
+  size_t i;
+  int stream = isStream (fasta);
+  int positional = isPositional (fasta);
+  int error = 0;
+  double * frequency = NULL;
+  Profile ** profiles = NULL;
+  if (parameters->sparse) {
+    profiles = malloc ((capacity + 1) * sizeof (Profile *));
+  }
+  else {
+    frequency = malloc ((capacity * numCombinations + 1) * sizeof (double));
+  }
+  /* Count the number of times each oligonucleotide appears in a sequence. */
+  #pragma omp parallel \
+    shared (fasta, parameters, frequency, profiles, next, error)
+  {
+    Sequence * seq = newSequence ();
+    Profile * profile = NULL;
+    size_t row = 0;
+    size_t index = 0;
+    int found;
+    int readable;
+    double * values = NULL;
+    double * counts = NULL;
+    Fragments fragments = {0};
+    /* Each thread keeps its own row, its own counts for canonical oligos
+       and its own fragments.  Its sequence object is refilled with each
+       sequence, so counting the sequences allocates no memory once its
+       buffers fit. */
+    if (! parameters->sparse) {
+      values = malloc (numCombinations * sizeof (double));
+    }
+    if (scratchLength (parameters) > 0) {
+      counts = malloc (scratchLength (parameters) * sizeof (double));
+    }
+    while (1) {
+      /* Grab the next sequence and the row it belongs in. */
+      #pragma omp critical (oligoFrequencyNext)
+      {
+        if (error) {
+          found = 0;
+        }
+        else if (stream) {
+          found = nextSequenceViewInto (fasta, seq);
+        }
+        else {
+          found = nextSequenceIndex (fasta, &index);
+          /* Without positional reads, read the sequence here in order. */
+          if (
+            found && ! positional &&
+            ! getSequenceByIndexInto (fasta, index, seq)
+          ) {
+            printf (
+              "Error, unable to read sequence %s!\n",
+              getIdentifierByIndex (fasta, index)
+            );
+            error = 1;
+            found = 0;
+          }
+        }
+        if (found) {
+          row = next;
+          next ++;
+        }
+      }
+      if (! found) {
+        break;
+      }
+      /* Read the sequence outside the critical section.  A sequence that
+         can not be read stops the counting, and its row is left out. */
+      readable = ! positional || getSequenceByIndexInto (fasta, index, seq);
+      if (! readable) {
+        #pragma omp critical (oligoFrequencyNext)
+        {
+          printf (
+            "Error, unable to read sequence %s!\n",
+            getIdentifierByIndex (fasta, index)
+          );
+          error = 1;
+        }
+      }
+      if (parameters->sparse) {
+        profile = NULL;
+        if (readable) {
+          profile = newProfile (
+            parameters->oligoLength, parameters->canonical
+          );
+          sequenceProfile (seq, row, profile, &fragments, parameters);
+          sortProfile (profile);
+        }
+      }
+      else if (readable) {
+        memset (values, 0, numCombinations * sizeof (double));
+        sequenceFrequency (
+          seq, row, values, counts, &fragments, parameters
+        );
+      }
+      /* Store the row, growing the matrix when it is full. */
+      #pragma omp critical (oligoFrequencyStore)
+      {
+        if (row >= capacity) {
+          while (row >= capacity) {
+            capacity = capacity > 0 ? 2 * capacity : 1024;
+          }
+          if (parameters->sparse) {
+            profiles = realloc (profiles, capacity * sizeof (Profile *));
+          }
+          else {
+            frequency = realloc (
+              frequency, capacity * numCombinations * sizeof (double)
+            );
+          }
+        }
+        if (parameters->sparse) {
+          profiles[row] = profile;
+        }
+        else {
+          memcpy (
+            frequency + row * numCombinations, values,
+            numCombinations * sizeof (double)
+          );
+        }
+      }
+    }
+    freeSequence (seq);
+    free (values);
+    free (counts);
+    free (fragments.starts);
+    free (fragments.lengths);
+  }
+  *numSequences = next;
+  /* The sequences of a fasta file read as a stream end at a read error. */
+  if (stream && hasReadError (fasta)) {
+    printf ("Error, unable to read the fasta file!\n");
+    error = 1;
+  }
+  /* Drop the matrix when a sequence could not be read. */
+  if (error) {
+    if (parameters->sparse) {
+      for (i = 0; i < next; i ++) {
+        if (profiles[i] != NULL) {
+          freeProfile (profiles[i]);
+        }
+      }
+      free (profiles);
+    }
+    free (frequency);
+    *numSequences = 0;
+    return NULL;
+  }
+  if (parameters->sparse) {
+    frequency = profileFrequency (profiles, next, parameters);
+  }
+  return frequency;
+}
+
+/**
+ * Build the frequency matrix from sparse profiles, using a column for each
+ * oligo found in at least one profile.
+ *
+ * The number of columns is stored in parameters, and the profiles are
+ * freed.
+ *
+ * @param profiles The sorted profile of each sequence.
+ * @param numSequences The number of sequences.
+ * @param parameters The parameters used to calculate the frequency.
+ * @return The oligo frequency matrix generated.
+ */
+double * profileFrequency (
+  Profile ** profiles,
   size_t numSequences,
-  size_t numCombinations,
-  size_t oligoLength,
-  size_t fragmentLength
+  Parameters * parameters
 ) {
-  size_t i, j, k, l;
-  size_t numSamples;
-  size_t numOligos;
-  size_t stepSize;
+  size_t i;
+  size_t numCombinations;
+  uint64_t * codes;
   double * frequency;
-  char ** oligonucleotides;
-  char * sample;
-  char * oligo;
-  int r;
-  /* Initialize the random number generator. */
-  srand (time (NULL));
-  /* Initialize the frequency matrix. */
-  frequency = malloc (numSequences * numCombinations * sizeof (double));
-  for (i = 0; i < numSequences * numCombinations; i ++) {
-    frequency[i] = 0.0;
-  }
-  /* Generate all of the nucleotide combinations. */
-  oligonucleotides = malloc (numCombinations * sizeof (char *));
-  generateOligonucleotides (oligoLength, oligonucleotides, "", 0);
-  /* Calculate the number of oligonucleotides that will be tested. */
-  numOligos = floor (fragmentLength / oligoLength);
-
-/*
-  #pragma omp parallel shared ( \
-    fasta, numSequences, oligoLength, numCombinations, frequency, \
-    oligonucleotides, numOligos \
-  )
-  #pragma omp for
-*/
-
-  /* Count the number of times each oligonucleotide appears in a sequence. */
-  Sequence * seq;
-  i = 0;
-  while (nextSequence (fasta, &seq)) {
-    size_t sequenceLength = getSequenceLength (seq);
-    /* Take samples from the sequence, and average the nucleotide usage of
-       the samples. */
-    numSamples = rint (
-      (1.5 * sequenceLength) / (1.0 * fragmentLength)
-    );
-    stepSize = rint (
-      (sequenceLength - fragmentLength) / (1.0 * numSamples)
+  codes = mergeProfileCodes (profiles, numSequences, &numCombinations);
+  parameters->numCombinations = numCombinations;
+  frequency = malloc (
+    (numSequences * numCombinations + 1) * sizeof (double)
+  );
+  #pragma omp parallel for
+  for (i = 0; i < numSequences; i ++) {
+    fillProfileRow (
+      profiles[i], codes, numCombinations, frequency + i * numCombinations
     );
-    for (j = 0; j < numSamples; j ++) {
-      /* Take a random sample of a section of the sequence. */
-      r = rand() % stepSize + j * stepSize;
-      sample = strndup (getSequence (seq) + r, fragmentLength);
-      for (k = 0; k < numOligos; k ++) {
-        /* Compare the oligo generated from the sequence with each possible
-           oligo. */
-        oligo = strndup (sample + k * oligoLength, oligoLength);
-        for (l = 0; l < numCombinations; l ++) {
-          /* Increment the frequency counter if a match is found in the
-             sequence. */
-          if (sequenceIsEqual (oligo, oligonucleotides[l])) {
-            #pragma omp critical
-            frequency[i * numCombinations + l] ++;
+    freeProfile (profiles[i]);
+  }
+  free (profiles);
+  free (codes);
+  return frequency;
+}
+
+/**
+ * Calculate the oligo usage frequency for each sequence in several fasta
+ * files.
+ *
+ * The files are handed out to the threads one at a time as each thread
+ * finishes its previous file, and each thread counts every sequence of its
+ * file.  The rows of each file are joined in the order of the files once
+ * every file has been counted, so the matrix is identical no matter how
+ * many threads are used.  The random fragments of a sequence are drawn
+ * from the stream of random numbers selected by the index of the file and
+ * the index of the sequence in the file.
+ *
+ * With parameters.genome, the oligos of every sequence in a file are
+ * counted together in a single row, named after the file.  Files that can
+ * not be loaded are left out, while a sequence that can not be read stops
+ * the counting.
+ *
+ * @param files The fasta files.
+ * @param numFiles The number of fasta files.
+ * @param numSequences Set to the number of rows.
+ * @param ids Set to the identifiers of the rows, which should be freed by
+ *        the caller.
+ * @param parameters The parameters used to calculate the frequency.
+ * @return The oligo frequency matrix generated, or NULL if a sequence can
+ *         not be read.
+ */
+double * fileFrequency (
+  char ** files,
+  size_t numFiles,
+  size_t * numSequences,
+  char *** ids,
+  Parameters * parameters
+) {
+  FileRows * rows = calloc (numFiles + 1, sizeof (FileRows));
+  size_t numCombinations = parameters->numCombinations;
+  size_t next = 0;
+  size_t size = 0;
+  size_t i, k;
+  int error = 0;
+  double * frequency = NULL;
+  Profile ** profiles = NULL;
+  /* Count the oligos of each file. */
+  #pragma omp parallel shared (files, rows, parameters, next, error)
+  {
+    Fasta * fasta;
+    Sequence * seq = newSequence ();
+    FileRows * file;
+    size_t index, j;
+    int failed;
+    double totals[KMER_MAX_LENGTH + 1];
+    double * counts = NULL;
+    Fragments fragments = {0};
+    if (scratchLength (parameters) > 0) {
+      counts = malloc (scratchLength (parameters) * sizeof (double));
+    }
+    while (1) {
+      /* Grab the next file. */
+      #pragma omp critical (fileFrequencyNext)
+      {
+        index = error ? numFiles : next;
+        next ++;
+      }
+      if (index >= numFiles) {
+        break;
+      }
+      fasta = newFasta (files[index]);
+      if (fasta == NULL) {
+        printf ("Error, unable to load fasta file %s!\n", files[index]);
+        continue;
+      }
+      setMinimumLength (fasta, parameters->fragmentLength);
+      setMinimumQuality (fasta, parameters->quality);
+      file = &rows[index];
+      /* Start the single row of the file. */
+      if (parameters->genome) {
+        file->size = 1;
+        file->ids = malloc (sizeof (char *));
+        file->ids[0] = strdup (files[index]);
+        if (parameters->sparse) {
+          file->profiles = malloc (sizeof (Profile *));
+          file->profiles[0] = newProfile (
+            parameters->oligoLength, parameters->canonical
+          );
+        }
+        else {
+          file->frequency = calloc (numCombinations, sizeof (double));
+          if (counts != NULL) {
+            memset (counts, 0, scratchLength (parameters) * sizeof (double));
           }
+          memset (totals, 0, sizeof (totals));
+        }
+      }
+      failed = 0;
+      for (j = 0; nextFileSequence (fasta, seq, files[index], &failed); j ++) {
+        uint64_t stream = (uint64_t)index << 32 | j;
+        if (parameters->genome) {
+          if (parameters->sparse) {
+            sequenceProfile (
+              seq, stream, file->profiles[0], &fragments, parameters
+            );
+          }
+          else {
+            countSequence (
+              seq, stream, file->frequency, counts, totals, &fragments,
+              parameters
+            );
+          }
+          continue;
+        }
+        /* Add a row for the sequence. */
+        if (file->size == file->capacity) {
+          file->capacity = file->capacity > 0 ? 2 * file->capacity : 16;
+          file->ids = realloc (file->ids, file->capacity * sizeof (char *));
+          if (parameters->sparse) {
+            file->profiles = realloc (
+              file->profiles, file->capacity * sizeof (Profile *)
+            );
+          }
+          else {
+            file->frequency = realloc (
+              file->frequency,
+              file->capacity * numCombinations * sizeof (double)
+            );
+          }
+        }
+        file->ids[file->size] = strdup (getIdentifier (seq));
+        if (parameters->sparse) {
+          file->profiles[file->size] = newProfile (
+            parameters->oligoLength, parameters->canonical
+          );
+          sequenceProfile (
+            seq, stream, file->profiles[file->size], &fragments, parameters
+          );
+          sortProfile (file->profiles[file->size]);
+        }
+        else {
+          memset (
+            file->frequency + file->size * numCombinations, 0,
+            numCombinations * sizeof (double)
+          );
+          sequenceFrequency (
+            seq, stream, file->frequency + file->size * numCombinations,
+            counts, &fragments, parameters
+          );
+        }
+        file->size ++;
+      }
+      /* Finish the single row of the file. */
+      if (parameters->genome) {
+        if (parameters->sparse) {
+          sortProfile (file->profiles[0]);
+        }
+        else {
+          normalizeFrequency (file->frequency, counts, totals, parameters);
+        }
+      }
+      freeFasta (fasta);
+      if (failed) {
+        #pragma omp critical (fileFrequencyNext)
+        {
+          error = 1;
         }
-        free (oligo);
       }
-      free (sample);
     }
     freeSequence (seq);
-    i ++;
+    free (counts);
+    free (fragments.starts);
+    free (fragments.lengths);
   }
-  /* Normalize the frequency values based on the number of samples and
-     length of the sequence. */
-  for (i = 0; i < numSequences; i ++) {
-    for (j = 0; j < numCombinations; j ++) {
-      frequency[i * numCombinations + j] /= 
-        numSamples * (fragmentLength - oligoLength + 1);
+  /* Drop the rows of every file when a sequence could not be read. */
+  if (error) {
+    for (i = 0; i < numFiles; i ++) {
+      for (k = 0; k < rows[i].size; k ++) {
+        free (rows[i].ids[k]);
+        if (parameters->sparse) {
+          freeProfile (rows[i].profiles[k]);
+        }
+      }
+      free (rows[i].ids);
+      free (rows[i].profiles);
+      free (rows[i].frequency);
     }
+    free (rows);
+    *numSequences = 0;
+    *ids = NULL;
+    return NULL;
+  }
+  /* Join the rows of the files in order. */
+  for (i = 0; i < numFiles; i ++) {
+    size += rows[i].size;
   }
-  /* Free the memory used by the oligonucleotides array. */
-  for (i = 0; i < numCombinations; i ++) {
-    free (oligonucleotides[i]);
+  *ids = malloc ((size + 1) * sizeof (char *));
+  if (parameters->sparse) {
+    profiles = malloc ((size + 1) * sizeof (Profile *));
+  }
+  else {
+    frequency = malloc ((size * numCombinations + 1) * sizeof (double));
+  }
+  size = 0;
+  for (i = 0; i < numFiles; i ++) {
+    memcpy (*ids + size, rows[i].ids, rows[i].size * sizeof (char *));
+    if (parameters->sparse) {
+      memcpy (
+        profiles + size, rows[i].profiles, rows[i].size * sizeof (Profile *)
+      );
+    }
+    else {
+      memcpy (
+        frequency + size * numCombinations, rows[i].frequency,
+        rows[i].size * numCombinations * sizeof (double)
+      );
+    }
+    size += rows[i].size;
+    free (rows[i].ids);
+    free (rows[i].profiles);
+    free (rows[i].frequency);
+  }
+  free (rows);
+  *numSequences = size;
+  if (parameters->sparse) {
+    frequency = profileFrequency (profiles, size, parameters);
   }
-  free (oligonucleotides);
   return frequency;
 }
+
+/**
+ * Read the next sequence of a fasta file counted by fileFrequency.
+ *
+ * The sequences of a fasta file read as a stream are parsed in order, and
+ * the others are read by index, so that a sequence that can not be read is
+ * told apart from the end of the file.
+ *
+ * @param fasta The fasta object.
+ * @param seq The sequence object to fill.
+ * @param fileName The name of the fasta file, used to report errors.
+ * @param error Set to true if a sequence can not be read.
+ * @return True if a sequence was read.
+ */
+int nextFileSequence (
+  Fasta * fasta,
+  Sequence * seq,
+  char * fileName,
+  int * error
+) {
+  size_t index;
+  if (isStream (fasta)) {
+    if (nextSequenceViewInto (fasta, seq)) {
+      return 1;
+    }
+    if (hasReadError (fasta)) {
+      printf ("Error, unable to read fasta file %s!\n", fileName);
+      *error = 1;
+    }
+    return 0;
+  }
+  if (! nextSequenceIndex (fasta, &index)) {
+    return 0;
+  }
+  if (! getSequenceByIndexInto (fasta, index, seq)) {
+    printf (
+      "Error, unable to read sequence %s of fasta file %s!\n",
+      getIdentifierByIndex (fasta, index), fileName
+    );
+    *error = 1;
+    return 0;
+  }
+  return 1;
+}
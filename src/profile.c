@@ -0,0 +1,480 @@
+/*
+ *  Copyright (c) 2014, Jason M. Wood <sandain@hotmail.com>
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Stores the oligo usage of a sequence in a sparse profile.
+ *
+ * @file profile.c
+ */
+
+#include "profile.h"
+
+/**
+ * @def PROFILE_EMPTY
+ *   The code used to mark an empty slot in the hash table.  Oligo codes are
+ *   at most 62 bits long, so this code is never used by an oligo.
+ */
+#define PROFILE_EMPTY UINT64_MAX
+
+/**
+ * A code and its count, used while sorting a profile.
+ *
+ * @private
+ */
+typedef struct ProfileEntry {
+  uint64_t code;                   /**< The code of the oligo. */
+  double count;                    /**< The count of the oligo. */
+} ProfileEntry;
+
+/**
+ * Compare two profile entries by code, for use with qsort.
+ *
+ * @private
+ * @param a The first entry.
+ * @param b The second entry.
+ * @return Less than, equal to, or greater than zero if a is less than,
+ *         equal to, or greater than b.
+ */
+static int compareProfileEntries (const void * a, const void * b) {
+  uint64_t codeA = ((const ProfileEntry *)a)->code;
+  uint64_t codeB = ((const ProfileEntry *)b)->code;
+  return (codeA > codeB) - (codeA < codeB);
+}
+
+/**
+ * Compare two codes, for use with qsort.
+ *
+ * @private
+ * @param a The first code.
+ * @param b The second code.
+ * @return Less than, equal to, or greater than zero if a is less than,
+ *         equal to, or greater than b.
+ */
+static int compareCodes (const void * a, const void * b) {
+  uint64_t codeA = *(const uint64_t *)a;
+  uint64_t codeB = *(const uint64_t *)b;
+  return (codeA > codeB) - (codeA < codeB);
+}
+
+/**
+ * Find the slot of a code in the hash table of a profile.
+ *
+ * @private
+ * @param codes The hash table.
+ * @param capacity The number of slots in the hash table.
+ * @param code The code to find.
+ * @return The slot holding the code, or the empty slot where it belongs.
+ */
+static size_t findProfileSlot (
+  uint64_t * codes,
+  size_t capacity,
+  uint64_t code
+) {
+  uint64_t hash = code * 0x9e3779b97f4a7c15ULL;
+  size_t slot = (hash ^ (hash >> 32)) & (capacity - 1);
+  while (codes[slot] != code && codes[slot] != PROFILE_EMPTY) {
+    slot = (slot + 1) & (capacity - 1);
+  }
+  return slot;
+}
+
+/**
+ * Double the number of slots in the hash table of a profile.
+ *
+ * @private
+ * @param profile The Profile object.
+ */
+static void growProfile (
+  Profile * profile
+) {
+  size_t capacity = profile->capacity * 2;
+  uint64_t * codes = malloc (capacity * sizeof (uint64_t));
+  double * counts = malloc (capacity * sizeof (double));
+  size_t i, slot;
+  for (i = 0; i < capacity; i ++) {
+    codes[i] = PROFILE_EMPTY;
+  }
+  for (i = 0; i < profile->capacity; i ++) {
+    if (profile->codes[i] != PROFILE_EMPTY) {
+      slot = findProfileSlot (codes, capacity, profile->codes[i]);
+      codes[slot] = profile->codes[i];
+      counts[slot] = profile->counts[i];
+    }
+  }
+  free (profile->codes);
+  free (profile->counts);
+  profile->codes = codes;
+  profile->counts = counts;
+  profile->capacity = capacity;
+}
+
+/**
+ * Increment the count of an oligo in a profile.
+ *
+ * @private
+ * @param profile The Profile object.
+ * @param code The code of the oligo.
+ */
+static void incrementProfile (
+  Profile * profile,
+  uint64_t code
+) {
+  size_t slot = findProfileSlot (profile->codes, profile->capacity, code);
+  if (profile->codes[slot] == PROFILE_EMPTY) {
+    /* Keep the hash table at most 70% full. */
+    if (10 * (profile->size + 1) > 7 * profile->capacity) {
+      growProfile (profile);
+      slot = findProfileSlot (profile->codes, profile->capacity, code);
+    }
+    profile->codes[slot] = code;
+    profile->counts[slot] = 0.0;
+    profile->size ++;
+  }
+  profile->counts[slot] ++;
+}
+
+/**
+ * Creates a new Profile object.
+ *
+ * @memberof Profile
+ * @public
+ * @param oligoLength The length of the oligos.
+ * @param canonical Count each oligo and its reverse complement as the same
+ *        oligo.
+ * @return The new Profile object.
+ */
+Profile * newProfile (
+  size_t oligoLength,
+  int canonical
+) {
+  Profile * profile = malloc (sizeof (Profile));
+  size_t i;
+  profile->oligoLength = oligoLength;
+  profile->canonical = canonical;
+  profile->size = 0;
+  profile->capacity = PROFILE_INITIAL_CAPACITY;
+  profile->codes = malloc (profile->capacity * sizeof (uint64_t));
+  profile->counts = malloc (profile->capacity * sizeof (double));
+  for (i = 0; i < profile->capacity; i ++) {
+    profile->codes[i] = PROFILE_EMPTY;
+  }
+  profile->total = 0.0;
+  profile->sorted = 0;
+  return profile;
+}
+
+/**
+ * Count the oligos found in a stretch of sequence data or packed
+ * nucleotides.
+ *
+ * @private
+ * @param profile The Profile object.
+ * @param sequence The sequence data, used when packed is NULL.
+ * @param packed The packed nucleotides, or NULL.
+ * @param start The position of the first packed nucleotide to use.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @return The number of oligos counted.
+ */
+static size_t countProfileOligosFrom (
+  Profile * profile,
+  char * sequence,
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  size_t stepSize
+) {
+  uint8_t codes[KMER_BLOCK_LENGTH / 4];
+  uint64_t ambiguous[KMER_BLOCK_LENGTH / 64];
+  size_t oligoLength = profile->oligoLength;
+  char buffer[KMER_BLOCK_LENGTH];
+  char * block;
+  size_t offset, used, blockLength;
+  size_t i;
+  size_t shift;
+  size_t position = 0;
+  size_t valid = 0;
+  size_t phase = 0;
+  size_t number = 0;
+  uint64_t mask;
+  uint64_t nuc;
+  uint64_t code = 0;
+  uint64_t reverse = 0;
+  if (
+    oligoLength == 0 || oligoLength > KMER_MAX_LENGTH || stepSize == 0 ||
+    profile->sorted
+  ) {
+    return 0;
+  }
+  shift = 2 * (oligoLength - 1);
+  mask = ((uint64_t)1 << (2 * oligoLength)) - 1;
+  for (offset = 0; offset < length; offset += used) {
+    /* Gather the next block of nucleotides, skipping line breaks. */
+    used = gatherNucleotides (
+      sequence, packed, start + offset, length - offset, buffer,
+      KMER_BLOCK_LENGTH, &block, &blockLength, codes, ambiguous
+    );
+    for (i = 0; i < blockLength; i ++) {
+      /* Roll the nucleotide into the forward and reverse complement codes,
+         or start over if the nucleotide is ambiguous. */
+      if ((ambiguous[i / 64] >> (i % 64)) & 1) {
+        valid = 0;
+      }
+      else {
+        nuc = (codes[i / 4] >> (2 * (i % 4))) & 3;
+        code = (code >> 2) | (nuc << shift);
+        reverse = ((reverse << 2) | (3 - nuc)) & mask;
+        valid ++;
+      }
+      /* Count the oligo ending at this nucleotide if it starts on a step
+         boundary and contains only unambiguous nucleotides. */
+      position ++;
+      if (position >= oligoLength) {
+        if (phase == 0 && valid >= oligoLength) {
+          if (profile->canonical && reverse < code) {
+            incrementProfile (profile, reverse);
+          }
+          else {
+            incrementProfile (profile, code);
+          }
+          number ++;
+        }
+        phase ++;
+        if (phase == stepSize) {
+          phase = 0;
+        }
+      }
+    }
+  }
+  profile->total += number;
+  return number;
+}
+
+/**
+ * Count the oligos found in a stretch of sequence data.
+ *
+ * @memberof Profile
+ * @public
+ * @param profile This Profile object.
+ * @param sequence The sequence data.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @return The number of oligos counted.
+ */
+size_t countProfileOligos (
+  Profile * profile,
+  char * sequence,
+  size_t length,
+  size_t stepSize
+) {
+  return countProfileOligosFrom (
+    profile, sequence, NULL, 0, length, stepSize
+  );
+}
+
+/**
+ * Count the oligos found in a stretch of packed nucleotides.
+ *
+ * @memberof Profile
+ * @public
+ * @param profile This Profile object.
+ * @param packed The packed nucleotides.
+ * @param start The position of the first nucleotide to use.
+ * @param length The number of nucleotides to use.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @return The number of oligos counted.
+ */
+size_t countPackedProfileOligos (
+  Profile * profile,
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  size_t stepSize
+) {
+  return countProfileOligosFrom (
+    profile, NULL, packed, start, length, stepSize
+  );
+}
+
+/**
+ * Pack the oligos of this profile into consecutive slots sorted by code.
+ *
+ * @memberof Profile
+ * @public
+ * @param profile This Profile object.
+ */
+void sortProfile (
+  Profile * profile
+) {
+  ProfileEntry * entries;
+  size_t i, j;
+  if (profile->sorted) {
+    return;
+  }
+  /* Gather the occupied slots of the hash table and sort them. */
+  entries = malloc ((profile->size + 1) * sizeof (ProfileEntry));
+  j = 0;
+  for (i = 0; i < profile->capacity; i ++) {
+    if (profile->codes[i] != PROFILE_EMPTY) {
+      entries[j].code = profile->codes[i];
+      entries[j].count = profile->counts[i];
+      j ++;
+    }
+  }
+  qsort (entries, profile->size, sizeof (ProfileEntry), compareProfileEntries);
+  /* Store the sorted oligos in arrays just large enough to hold them. */
+  profile->capacity = profile->size;
+  profile->codes = realloc (
+    profile->codes, (profile->capacity + 1) * sizeof (uint64_t)
+  );
+  profile->counts = realloc (
+    profile->counts, (profile->capacity + 1) * sizeof (double)
+  );
+  for (i = 0; i < profile->size; i ++) {
+    profile->codes[i] = entries[i].code;
+    profile->counts[i] = entries[i].count;
+  }
+  profile->sorted = 1;
+  free (entries);
+}
+
+/**
+ * Retrieves the number of distinct oligos in this profile.
+ *
+ * @memberof Profile
+ * @public
+ * @param profile This Profile object.
+ * @return The number of distinct oligos.
+ */
+size_t getProfileSize (
+  Profile * profile
+) {
+  return profile->size;
+}
+
+/**
+ * Retrieves the number of oligos counted in this profile.
+ *
+ * @memberof Profile
+ * @public
+ * @param profile This Profile object.
+ * @return The number of oligos counted.
+ */
+double getProfileTotal (
+  Profile * profile
+) {
+  return profile->total;
+}
+
+/**
+ * Merge the codes of the oligos found in sorted profiles.
+ *
+ * @param profiles The sorted profiles.
+ * @param numProfiles The number of profiles.
+ * @param numCodes The number of distinct codes found.
+ * @return The sorted array of distinct codes found in any of the profiles.
+ */
+uint64_t * mergeProfileCodes (
+  Profile ** profiles,
+  size_t numProfiles,
+  size_t * numCodes
+) {
+  uint64_t * codes;
+  size_t number = 0;
+  size_t i, j;
+  for (i = 0; i < numProfiles; i ++) {
+    number += profiles[i]->size;
+  }
+  codes = malloc ((number + 1) * sizeof (uint64_t));
+  /* Gather every code and sort them. */
+  number = 0;
+  for (i = 0; i < numProfiles; i ++) {
+    memcpy (
+      codes + number, profiles[i]->codes, profiles[i]->size * sizeof (uint64_t)
+    );
+    number += profiles[i]->size;
+  }
+  qsort (codes, number, sizeof (uint64_t), compareCodes);
+  /* Remove the duplicate codes. */
+  j = 0;
+  for (i = 0; i < number; i ++) {
+    if (j == 0 || codes[i] != codes[j - 1]) {
+      codes[j] = codes[i];
+      j ++;
+    }
+  }
+  *numCodes = j;
+  return realloc (codes, (j + 1) * sizeof (uint64_t));
+}
+
+/**
+ * Fill a dense row of oligo usage frequency from a sorted profile.
+ *
+ * @memberof Profile
+ * @public
+ * @param profile This Profile object.
+ * @param codes The sorted codes of the columns of the row.
+ * @param numCodes The number of columns in the row.
+ * @param frequency The row to fill with the frequency of each oligo.
+ */
+void fillProfileRow (
+  Profile * profile,
+  uint64_t * codes,
+  size_t numCodes,
+  double * frequency
+) {
+  size_t i;
+  size_t j = 0;
+  for (i = 0; i < numCodes; i ++) {
+    /* Walk both sorted lists of codes together. */
+    while (j < profile->size && profile->codes[j] < codes[i]) {
+      j ++;
+    }
+    if (j < profile->size && profile->codes[j] == codes[i]) {
+      frequency[i] = profile->counts[j] / profile->total;
+    }
+    else {
+      frequency[i] = 0.0;
+    }
+  }
+}
+
+/**
+ * Free the memory reserved for this Profile object.
+ *
+ * @memberof Profile
+ * @public
+ * @param profile The Profile object to free.
+ */
+void freeProfile (
+  Profile * profile
+) {
+  free (profile->codes);
+  free (profile->counts);
+  free (profile);
+}
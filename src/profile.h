@@ -0,0 +1,205 @@
+/*
+ *  Copyright (c) 2014, Jason M. Wood <sandain@hotmail.com>
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Stores the oligo usage of a sequence in a sparse profile.
+ *
+ * @file profile.h
+ */
+
+#ifndef _OLIGO_PROFILE_H
+#define _OLIGO_PROFILE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "kmer.h"
+#include "tools.h"
+
+/**
+ * @def PROFILE_INITIAL_CAPACITY
+ *   The initial number of slots in the hash table of a profile.  Must be a
+ *   power of 2.
+ */
+#define PROFILE_INITIAL_CAPACITY 1024
+
+/**
+ * The structure to hold a Profile object.
+ *
+ * Oligos are counted in an open addressing hash table keyed by their code,
+ * so memory grows with the number of distinct oligos found instead of with
+ * 4^oligoLength.  Once counting is finished, sortProfile packs the oligos
+ * into code order.
+ *
+ * @public
+ */
+typedef struct Profile {
+  size_t oligoLength;              /**< The length of the oligos. */
+  int canonical;                   /**< Merge reverse complement oligos. */
+  size_t size;                     /**< The number of distinct oligos. */
+  size_t capacity;                 /**< The number of hash table slots. */
+  uint64_t * codes;                /**< The codes of the oligos. */
+  double * counts;                 /**< The counts of the oligos. */
+  double total;                    /**< The number of oligos counted. */
+  int sorted;                      /**< The oligos are sorted by code. */
+} Profile;
+
+/**
+ * Creates a new Profile object.
+ *
+ * @memberof Profile
+ * @public
+ * @param oligoLength The length of the oligos.
+ * @param canonical Count each oligo and its reverse complement as the same
+ *        oligo.
+ * @return The new Profile object.
+ */
+extern Profile * newProfile (
+  size_t oligoLength,
+  int canonical
+);
+
+/**
+ * Count the oligos found in a stretch of sequence data.
+ *
+ * @memberof Profile
+ * @public
+ * @param profile This Profile object.
+ * @param sequence The sequence data.
+ * @param length The number of nucleotides in the sequence data to use.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @return The number of oligos counted.
+ */
+extern size_t countProfileOligos (
+  Profile * profile,
+  char * sequence,
+  size_t length,
+  size_t stepSize
+);
+
+/**
+ * Count the oligos found in a stretch of packed nucleotides, the same as
+ * countProfileOligos.
+ *
+ * @memberof Profile
+ * @public
+ * @param profile This Profile object.
+ * @param packed The packed nucleotides.
+ * @param start The position of the first nucleotide to use.
+ * @param length The number of nucleotides to use.
+ * @param stepSize The distance between the start of each oligo counted.
+ * @return The number of oligos counted.
+ */
+extern size_t countPackedProfileOligos (
+  Profile * profile,
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  size_t stepSize
+);
+
+/**
+ * Pack the oligos of this profile into consecutive slots sorted by code.
+ * No more oligos can be counted afterwards.
+ *
+ * @memberof Profile
+ * @public
+ * @param profile This Profile object.
+ */
+extern void sortProfile (
+  Profile * profile
+);
+
+/**
+ * Retrieves the number of distinct oligos in this profile.
+ *
+ * @memberof Profile
+ * @public
+ * @param profile This Profile object.
+ * @return The number of distinct oligos.
+ */
+extern size_t getProfileSize (
+  Profile * profile
+);
+
+/**
+ * Retrieves the number of oligos counted in this profile.
+ *
+ * @memberof Profile
+ * @public
+ * @param profile This Profile object.
+ * @return The number of oligos counted.
+ */
+extern double getProfileTotal (
+  Profile * profile
+);
+
+/**
+ * Merge the codes of the oligos found in sorted profiles.
+ *
+ * @param profiles The sorted profiles.
+ * @param numProfiles The number of profiles.
+ * @param numCodes The number of distinct codes found.
+ * @return The sorted array of distinct codes found in any of the profiles.
+ */
+extern uint64_t * mergeProfileCodes (
+  Profile ** profiles,
+  size_t numProfiles,
+  size_t * numCodes
+);
+
+/**
+ * Fill a dense row of oligo usage frequency from a sorted profile.
+ *
+ * @memberof Profile
+ * @public
+ * @param profile This Profile object.
+ * @param codes The sorted codes of the columns of the row.
+ * @param numCodes The number of columns in the row.
+ * @param frequency The row to fill with the frequency of each oligo.
+ */
+extern void fillProfileRow (
+  Profile * profile,
+  uint64_t * codes,
+  size_t numCodes,
+  double * frequency
+);
+
+/**
+ * Free the memory reserved for this Profile object.
+ *
+ * @memberof Profile
+ * @public
+ * @param profile The Profile object to free.
+ */
+extern void freeProfile (
+  Profile * profile
+);
+
+#endif
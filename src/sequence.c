@@ -34,6 +34,55 @@
 
 #include "sequence.h"
 
+/**
+ * Free the packed sequence data, if there is any.
+ *
+ * @private
+ * @param seq The sequence object.
+ */
+static void releasePacked (Sequence * seq) {
+  if (seq->packed != NULL) {
+    freePackedNucleotides (seq->packed);
+    seq->packed = NULL;
+  }
+}
+
+/**
+ * Find the description in the header line, if it has not been found yet.
+ * The description starts after the white space that follows the
+ * identifier.
+ *
+ * @private
+ * @param seq The sequence object.
+ */
+static void parseDescription (Sequence * seq) {
+  char * description;
+  if (seq->header != NULL && seq->description == NULL) {
+    description = seq->identifier + seq->identifierLength + 1;
+    description += strspn (description, " \t");
+    seq->description = description;
+    seq->descriptionLength = strlen (description);
+  }
+}
+
+/**
+ * Copy the identifier and description out of the header line, so they can
+ * be changed, and free the header line.
+ *
+ * @private
+ * @param seq The sequence object.
+ */
+static void releaseHeader (Sequence * seq) {
+  if (seq->header != NULL) {
+    parseDescription (seq);
+    seq->identifier = strdup (seq->identifier);
+    seq->description = strdup (seq->description);
+    free (seq->header);
+    seq->header = NULL;
+    seq->headerSize = 0;
+  }
+}
+
 /**
  * Creates a new Sequence object.
  *
@@ -55,6 +104,13 @@ Sequence * newSequence (void) {
   seq->identifierLength = 0;
   seq->descriptionLength = 0;
   seq->sequenceLength = 0;
+  seq->lineBases = 0;
+  seq->lineWidth = 0;
+  seq->borrowed = 0;
+  seq->packed = NULL;
+  seq->header = NULL;
+  seq->headerSize = 0;
+  seq->sequenceSize = 1;
   return seq;
 }
 
@@ -67,6 +123,7 @@ Sequence * newSequence (void) {
  * @param identifier The sequence description.
  */
 void setIdentifier (Sequence * seq, char * identifier) {
+  releaseHeader (seq);
   seq->identifierLength = strlen (identifier);
   seq->identifier = realloc (
     seq->identifier, (seq->identifierLength + 1) * sizeof (char)
@@ -84,6 +141,7 @@ void setIdentifier (Sequence * seq, char * identifier) {
  * @param description The sequence description.
  */
 void setDescription (Sequence * seq, char * description) {
+  releaseHeader (seq);
   seq->descriptionLength = strlen(description);
   seq->description = realloc (
     seq->description, (seq->descriptionLength + 1) * sizeof (char)
@@ -92,6 +150,45 @@ void setDescription (Sequence * seq, char * description) {
   seq->description[seq->descriptionLength] = '\0';
 }
 
+/**
+ * Store the header line of a FASTA or FASTQ record in the sequence object.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object to store the header line in.
+ * @param header The header line, without the '>' or '@' at the start or
+ *        the line-feed at the end.
+ */
+void setHeader (Sequence * seq, char * header) {
+  size_t length = strlen (header);
+  char * identifier;
+  char * end;
+  if (seq->header == NULL) {
+    free (seq->identifier);
+    free (seq->description);
+  }
+  /* Reuse the buffer of the last header line when it is big enough. */
+  if (length + 1 > seq->headerSize) {
+    seq->headerSize = length + 1;
+    seq->header = realloc (seq->header, seq->headerSize * sizeof (char));
+  }
+  memcpy (seq->header, header, length + 1);
+  /* The identifier is the first word of the header line. */
+  identifier = seq->header + strspn (seq->header, " \t");
+  end = identifier + strcspn (identifier, " \t");
+  seq->identifier = identifier;
+  seq->identifierLength = end - identifier;
+  /* The description is found when it is asked for. */
+  seq->description = NULL;
+  seq->descriptionLength = 0;
+  if (*end == '\0') {
+    seq->description = end;
+  }
+  else {
+    *end = '\0';
+  }
+}
+
 /**
  * Store sequence data in the sequence object.
  *
@@ -101,14 +198,181 @@ void setDescription (Sequence * seq, char * description) {
  * @param sequence The sequence data.
  */
 void setSequence (Sequence * seq, char * sequence) {
+  releasePacked (seq);
+  if (seq->borrowed) {
+    seq->sequence = NULL;
+    seq->lineBases = 0;
+    seq->borrowed = 0;
+  }
   seq->sequenceLength = strlen (sequence);
-  seq->sequence = realloc (
-    seq->sequence, (seq->sequenceLength + 1) * sizeof (char)
-  );
+  seq->sequenceSize = seq->sequenceLength + 1;
+  seq->sequence = realloc (seq->sequence, seq->sequenceSize * sizeof (char));
   strcpy (seq->sequence, sequence);
   seq->sequence[seq->sequenceLength] = '\0';
 }
 
+/**
+ * Store sequence data in the sequence object without copying it.  The
+ * sequence object takes ownership of the buffer, which must have been
+ * allocated with malloc and hold length characters followed by a null
+ * character.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object to store the sequence data in.
+ * @param sequence The buffer holding the sequence data.
+ * @param length The length of the sequence data.
+ */
+void adoptSequence (Sequence * seq, char * sequence, size_t length) {
+  releasePacked (seq);
+  if (! seq->borrowed) {
+    free (seq->sequence);
+  }
+  seq->sequence = sequence;
+  seq->sequenceLength = length;
+  seq->sequenceSize = length + 1;
+  seq->lineBases = 0;
+  seq->borrowed = 0;
+}
+
+/**
+ * Make room for sequence data in a buffer owned by the sequence object.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object.
+ * @param capacity The number of nucleotides to make room for.
+ * @return The buffer, with room for capacity nucleotides and a null
+ *         character.
+ */
+char * reserveSequence (Sequence * seq, size_t capacity) {
+  size_t size;
+  releasePacked (seq);
+  if (seq->borrowed) {
+    seq->sequence = NULL;
+    seq->sequenceSize = 0;
+    seq->sequenceLength = 0;
+    seq->lineBases = 0;
+    seq->borrowed = 0;
+  }
+  if (capacity + 1 > seq->sequenceSize) {
+    /* Take the exact size asked for when it is more than double, so a
+       known length is not rounded up. */
+    size = 2 * seq->sequenceSize;
+    if (size < capacity + 1) {
+      size = capacity + 1;
+    }
+    seq->sequence = realloc (seq->sequence, size * sizeof (char));
+    seq->sequenceSize = size;
+  }
+  return seq->sequence;
+}
+
+/**
+ * Set the length of the sequence data written to the buffer returned by
+ * reserveSequence.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object.
+ * @param length The length of the sequence data.
+ */
+void setSequenceLength (Sequence * seq, size_t length) {
+  seq->sequence[length] = '\0';
+  seq->sequenceLength = length;
+}
+
+/**
+ * Store a view of sequence data in the sequence object.  The sequence data
+ * is not copied or owned by the sequence object, and may be broken into
+ * lines of lineBases nucleotides, each followed by line break characters
+ * to make lines of lineWidth bytes.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object to store the view in.
+ * @param data The first nucleotide of the sequence data.
+ * @param length The number of nucleotides in the sequence data.
+ * @param lineBases The number of nucleotides per line, or 0 if the sequence
+ *        data is not broken into lines.
+ * @param lineWidth The number of bytes per line.
+ */
+void viewSequence (
+  Sequence * seq,
+  char * data,
+  size_t length,
+  size_t lineBases,
+  size_t lineWidth
+) {
+  releasePacked (seq);
+  if (! seq->borrowed) {
+    free (seq->sequence);
+  }
+  seq->sequence = data;
+  seq->sequenceLength = length;
+  seq->sequenceSize = 0;
+  seq->lineBases = lineBases;
+  seq->lineWidth = lineWidth;
+  seq->borrowed = 1;
+}
+
+/**
+ * Store the sequence data in packed form.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object to pack.
+ */
+void packSequence (Sequence * seq) {
+  size_t bytes;
+  if (seq->packed != NULL) {
+    return;
+  }
+  getSequenceRange (seq, 0, seq->sequenceLength, &bytes);
+  seq->packed = packNucleotides (seq->sequence, bytes);
+  if (! seq->borrowed) {
+    free (seq->sequence);
+  }
+  seq->sequence = NULL;
+  seq->sequenceSize = 0;
+  seq->sequenceLength = seq->packed->length;
+  seq->lineBases = 0;
+  seq->borrowed = 0;
+}
+
+/**
+ * Store packed sequence data in the sequence object without copying it.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object to store the sequence data in.
+ * @param packed The packed nucleotides.
+ */
+void adoptPackedSequence (Sequence * seq, PackedNucleotides * packed) {
+  releasePacked (seq);
+  if (! seq->borrowed) {
+    free (seq->sequence);
+  }
+  seq->sequence = NULL;
+  seq->sequenceSize = 0;
+  seq->sequenceLength = packed->length;
+  seq->lineBases = 0;
+  seq->borrowed = 0;
+  seq->packed = packed;
+}
+
+/**
+ * Get the packed sequence data.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object.
+ * @return The packed sequence data, or NULL if the sequence is not packed.
+ */
+PackedNucleotides * getPackedSequence (Sequence * seq) {
+  return seq->packed;
+}
+
 /**
  * Get the sequence identifier.
  *
@@ -142,6 +406,7 @@ size_t getIdentifierLength (Sequence * seq) {
  * @return The sequence description.
  */
 char * getDescription (Sequence * seq) {
+  parseDescription (seq);
   return seq->description;
 }
 
@@ -154,11 +419,13 @@ char * getDescription (Sequence * seq) {
  * @return The length of the sequence description.
  */
 size_t getDescriptionLength (Sequence * seq) {
+  parseDescription (seq);
   return seq->descriptionLength;
 }
 
 /**
- * Get the sequence.
+ * Get the sequence.  A view has no sequence data terminated by a null
+ * character, so NULL is returned for a view; use getSequenceRange instead.
  *
  * @memberof Sequence
  * @public
@@ -166,9 +433,55 @@ size_t getDescriptionLength (Sequence * seq) {
  * @return The sequence.
  */
 char * getSequence (Sequence * seq) {
+  if (seq->borrowed) {
+    return NULL;
+  }
+  /* Unpack a packed sequence on demand. */
+  if (seq->sequence == NULL && seq->packed != NULL) {
+    seq->sequenceSize = seq->sequenceLength + 1;
+    seq->sequence = malloc (seq->sequenceSize * sizeof (char));
+    unpackNucleotides (seq->packed, 0, seq->sequenceLength, seq->sequence);
+    seq->sequence[seq->sequenceLength] = '\0';
+  }
   return seq->sequence;
 }
 
+/**
+ * Get the sequence data of part of the sequence.  The sequence data of a
+ * view may include line breaks, which the counting methods skip.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object.
+ * @param start The position of the first nucleotide.
+ * @param length The number of nucleotides.
+ * @param bytes Set to the number of bytes of sequence data that hold the
+ *        nucleotides.
+ * @return The sequence data of the first nucleotide.
+ */
+char * getSequenceRange (
+  Sequence * seq,
+  size_t start,
+  size_t length,
+  size_t * bytes
+) {
+  size_t first, last;
+  if (seq->lineBases == 0 || length == 0) {
+    *bytes = length;
+    if (seq->borrowed) {
+      return seq->sequence + start;
+    }
+    return getSequence (seq) + start;
+  }
+  /* Find the bytes of the first and last nucleotides from the length of
+     the lines. */
+  first = start / seq->lineBases * seq->lineWidth + start % seq->lineBases;
+  last = (start + length - 1) / seq->lineBases * seq->lineWidth +
+    (start + length - 1) % seq->lineBases;
+  *bytes = last - first + 1;
+  return seq->sequence + first;
+}
+
 /**
  * Get the length of the sequence.
  *
@@ -189,8 +502,16 @@ size_t getSequenceLength (Sequence * seq) {
  * @param seq The sequence object to free.
  */
 void freeSequence (Sequence * seq) {
-  free (seq->identifier);
-  free (seq->description);
-  free (seq->sequence);
+  releasePacked (seq);
+  if (seq->header != NULL) {
+    free (seq->header);
+  }
+  else {
+    free (seq->identifier);
+    free (seq->description);
+  }
+  if (! seq->borrowed) {
+    free (seq->sequence);
+  }
   free (seq);
 }
@@ -38,6 +38,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "tools.h"
+
 /**
  * The structure to hold a Sequence object.
  *
@@ -50,6 +52,13 @@ typedef struct Sequence {
   size_t identifierLength;         /**< The length of the identifier. */ 
   size_t descriptionLength;        /**< The length of the description. */
   size_t sequenceLength;           /**< The length of the sequence data. */
+  size_t lineBases;                /**< The nucleotides per line of a view. */
+  size_t lineWidth;                /**< The bytes per line of a view. */
+  int borrowed;                    /**< True if the data is not owned. */
+  PackedNucleotides * packed;      /**< The packed sequence data, or NULL. */
+  char * header;                   /**< The unparsed header line, or NULL. */
+  size_t headerSize;               /**< The bytes allocated to the header. */
+  size_t sequenceSize;             /**< The bytes allocated to the data. */
 } Sequence;
 
 /**
@@ -81,6 +90,22 @@ extern void setIdentifier (Sequence * seq, char * identifier);
  */
 extern void setDescription (Sequence * seq, char * description);
 
+/**
+ * Store the header line of a FASTA or FASTQ record in the sequence object.
+ * The header line is copied into a buffer of the sequence object that is
+ * kept from one header line to the next, and only grows.  The identifier
+ * is the first word of the header line, and points into the buffer.  The
+ * description, the rest of the line, is only found when it is asked for by
+ * getDescription or getDescriptionLength.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object to store the header line in.
+ * @param header The header line, without the '>' or '@' at the start or
+ *        the line-feed at the end.
+ */
+extern void setHeader (Sequence * seq, char * header);
+
 /**
  * Store sequence data in the sequence object.
  *
@@ -91,6 +116,109 @@ extern void setDescription (Sequence * seq, char * description);
  */
 extern void setSequence (Sequence * seq, char * sequence);
 
+/**
+ * Store sequence data in the sequence object without copying it.  The
+ * sequence object takes ownership of the buffer, which must have been
+ * allocated with malloc and hold length characters followed by a null
+ * character.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object to store the sequence data in.
+ * @param sequence The buffer holding the sequence data.
+ * @param length The length of the sequence data.
+ */
+extern void adoptSequence (Sequence * seq, char * sequence, size_t length);
+
+/**
+ * Make room for sequence data in a buffer owned by the sequence object,
+ * which is filled by the caller and finished with setSequenceLength.  The
+ * sequence data already in the buffer is kept.  The buffer only grows, at
+ * least doubling in size, so a sequence object that is refilled over and
+ * over stops allocating memory once it has held the longest sequence.  A
+ * view or packed sequence data is released first.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object.
+ * @param capacity The number of nucleotides to make room for.
+ * @return The buffer, with room for capacity nucleotides and a null
+ *         character.
+ */
+extern char * reserveSequence (Sequence * seq, size_t capacity);
+
+/**
+ * Set the length of the sequence data written to the buffer returned by
+ * reserveSequence, and terminate it with a null character.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object.
+ * @param length The length of the sequence data.
+ */
+extern void setSequenceLength (Sequence * seq, size_t length);
+
+/**
+ * Store a view of sequence data in the sequence object.  The sequence data
+ * is not copied or owned by the sequence object, and may be broken into
+ * lines of lineBases nucleotides, each followed by line break characters
+ * to make lines of lineWidth bytes.  Use getSequenceRange to find the
+ * sequence data of part of the view, as getSequence returns NULL for a
+ * view.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object to store the view in.
+ * @param data The first nucleotide of the sequence data.
+ * @param length The number of nucleotides in the sequence data.
+ * @param lineBases The number of nucleotides per line, or 0 if the sequence
+ *        data is not broken into lines.
+ * @param lineWidth The number of bytes per line.
+ */
+extern void viewSequence (
+  Sequence * seq,
+  char * data,
+  size_t length,
+  size_t lineBases,
+  size_t lineWidth
+);
+
+/**
+ * Store the sequence data in packed form, 2 bits per nucleotide with the
+ * runs of ambiguous and lowercase nucleotides kept in lists (see
+ * packNucleotides).  The character data is released, so a sequence takes
+ * about a quarter of the memory.  The counting methods read the packed
+ * form directly (see getPackedSequence), while getSequence and
+ * getSequenceRange unpack the sequence data again on demand.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object to pack.
+ */
+extern void packSequence (Sequence * seq);
+
+/**
+ * Store packed sequence data in the sequence object without copying it.
+ * The sequence object takes ownership of the packed nucleotides, which
+ * must have been allocated with malloc, the same as packNucleotides.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object to store the sequence data in.
+ * @param packed The packed nucleotides.
+ */
+extern void adoptPackedSequence (Sequence * seq, PackedNucleotides * packed);
+
+/**
+ * Get the packed sequence data.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object.
+ * @return The packed sequence data, or NULL if the sequence is not packed.
+ */
+extern PackedNucleotides * getPackedSequence (Sequence * seq);
+
 /**
  * Get the sequence identifier.
  *
@@ -132,15 +260,39 @@ extern char * getDescription (Sequence * seq);
 extern size_t getDescriptionLength (Sequence * seq);
 
 /**
- * Get the sequence.
+ * Get the sequence, terminated by a null character.  The sequence data of
+ * a view is not terminated by a null character and may include line
+ * breaks, so NULL is returned for a view; use getSequenceRange instead.  A
+ * packed sequence is unpacked the first time, and keeps the character
+ * data until it is freed.
  *
  * @memberof Sequence
  * @public
  * @param seq The sequence object.
- * @return The sequence.
+ * @return The sequence, or NULL if the sequence object holds a view.
  */
 extern char * getSequence (Sequence * seq);
 
+/**
+ * Get the sequence data of part of the sequence.  The sequence data of a
+ * view may include line breaks, which the counting methods skip.
+ *
+ * @memberof Sequence
+ * @public
+ * @param seq The sequence object.
+ * @param start The position of the first nucleotide.
+ * @param length The number of nucleotides.
+ * @param bytes Set to the number of bytes of sequence data that hold the
+ *        nucleotides.
+ * @return The sequence data of the first nucleotide.
+ */
+extern char * getSequenceRange (
+  Sequence * seq,
+  size_t start,
+  size_t length,
+  size_t * bytes
+);
+
 /**
  * Get the length of the sequence.
  *
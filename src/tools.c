@@ -34,6 +34,63 @@
 
 #include "tools.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TOOLS_X86_SIMD 1
+#endif
+
+/**
+ * The 2 bit code of each character: A = 0, C = 1, G = 2, T = 3.  Every other
+ * character is given the code 4.
+ *
+ * @public
+ */
+const unsigned char nucleotideCodes[256] = {
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4
+};
+
+/**
+ * The IUPAC bitmask of each character: A = 1, C = 2, G = 4 and T = 8, with
+ * each ambiguity code the union of the nucleotides it stands for (N = 15).
+ * Gaps (. and -) are given 16, unknown nucleotides (?) 32, and every other
+ * character 0.
+ *
+ * @public
+ */
+const unsigned char nucleotideMasks[256] = {
+   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 16, 16,  0,
+   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 32,
+   0,  1, 14,  2, 13,  0,  0,  4, 11,  0,  0, 12,  0,  3, 15,  0,
+   0,  0,  5,  6,  8,  0,  7,  9,  0, 10,  0,  0,  0,  0,  0,  0,
+   0,  1, 14,  2, 13,  0,  0,  4, 11,  0,  0, 12,  0,  3, 15,  0,
+   0,  0,  5,  6,  8,  0,  7,  9,  0, 10,  0,  0,  0,  0,  0,  0,
+   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+};
+
 /**
  * Removes line-feed and carriage-return characters from the end of a string.
  *
@@ -184,89 +241,600 @@ char * reverseComplement (char * string) {
   return reverseComplement;
 }
 
+/**
+ * Encode nucleotides into packed 2 bit codes one character at a time.
+ *
+ * @private
+ * @param string The strand of DNA to encode.
+ * @param start The position of the first nucleotide to encode.
+ * @param length The number of nucleotides to encode.
+ * @param codes The packed codes.
+ * @param ambiguous The bitmask of ambiguous positions.
+ */
+static void encodeNucleotidesScalar (
+  char * string,
+  size_t start,
+  size_t length,
+  uint8_t * codes,
+  uint64_t * ambiguous
+) {
+  size_t i;
+  unsigned char code;
+  for (i = start; i < length; i ++) {
+    code = nucleotideCodes[(unsigned char)string[i]];
+    if (code > 3) {
+      ambiguous[i / 64] |= (uint64_t)1 << (i % 64);
+      code = 0;
+    }
+    if (i % 4 == 0) {
+      codes[i / 4] = 0;
+    }
+    codes[i / 4] |= code << (2 * (i % 4));
+  }
+}
+
+#ifdef TOOLS_X86_SIMD
+
+/**
+ * Encode nucleotides into packed 2 bit codes 16 at a time with SSE4.1.
+ *
+ * The low nibble of A, C, G and T (1, 3, 7 and 4) is the same in either
+ * case, and is used to look up the code with a byte shuffle.  Pairs of
+ * codes are then merged with multiply-adds until each 32 bit lane holds
+ * four packed codes.
+ *
+ * @private
+ * @param string The strand of DNA to encode.
+ * @param length The number of nucleotides to encode.
+ * @param codes The packed codes.
+ * @param ambiguous The bitmask of ambiguous positions.
+ * @return The number of nucleotides encoded.
+ */
+__attribute__ ((target ("sse4.1")))
+static size_t encodeNucleotidesSSE (
+  char * string,
+  size_t length,
+  uint8_t * codes,
+  uint64_t * ambiguous
+) {
+  const __m128i lookup = _mm_setr_epi8 (
+    0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0
+  );
+  const __m128i caseMask = _mm_set1_epi8 ((char)0xdf);
+  const __m128i nibbleMask = _mm_set1_epi8 (0x0f);
+  const __m128i pairWeights = _mm_set1_epi16 (0x0401);
+  const __m128i quadWeights = _mm_set1_epi32 (0x00100001);
+  const __m128i gather = _mm_setr_epi8 (
+    0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+  );
+  size_t i;
+  for (i = 0; i + 16 <= length; i += 16) {
+    __m128i chars = _mm_loadu_si128 ((__m128i *)(string + i));
+    __m128i upper = _mm_and_si128 (chars, caseMask);
+    __m128i valid = _mm_or_si128 (
+      _mm_or_si128 (
+        _mm_cmpeq_epi8 (upper, _mm_set1_epi8 ('A')),
+        _mm_cmpeq_epi8 (upper, _mm_set1_epi8 ('C'))
+      ),
+      _mm_or_si128 (
+        _mm_cmpeq_epi8 (upper, _mm_set1_epi8 ('G')),
+        _mm_cmpeq_epi8 (upper, _mm_set1_epi8 ('T'))
+      )
+    );
+    __m128i code = _mm_and_si128 (
+      _mm_shuffle_epi8 (lookup, _mm_and_si128 (chars, nibbleMask)), valid
+    );
+    __m128i packed = _mm_madd_epi16 (
+      _mm_maddubs_epi16 (code, pairWeights), quadWeights
+    );
+    uint32_t bytes = _mm_cvtsi128_si32 (_mm_shuffle_epi8 (packed, gather));
+    uint64_t bits = ~_mm_movemask_epi8 (valid) & 0xffff;
+    memcpy (codes + i / 4, &bytes, sizeof (bytes));
+    ambiguous[i / 64] |= bits << (i % 64);
+  }
+  return i;
+}
+
+/**
+ * Encode nucleotides into packed 2 bit codes 32 at a time with AVX2.
+ *
+ * @private
+ * @param string The strand of DNA to encode.
+ * @param length The number of nucleotides to encode.
+ * @param codes The packed codes.
+ * @param ambiguous The bitmask of ambiguous positions.
+ * @return The number of nucleotides encoded.
+ */
+__attribute__ ((target ("avx2")))
+static size_t encodeNucleotidesAVX2 (
+  char * string,
+  size_t length,
+  uint8_t * codes,
+  uint64_t * ambiguous
+) {
+  const __m256i lookup = _mm256_setr_epi8 (
+    0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0
+  );
+  const __m256i caseMask = _mm256_set1_epi8 ((char)0xdf);
+  const __m256i nibbleMask = _mm256_set1_epi8 (0x0f);
+  const __m256i pairWeights = _mm256_set1_epi16 (0x0401);
+  const __m256i quadWeights = _mm256_set1_epi32 (0x00100001);
+  const __m256i gather = _mm256_setr_epi8 (
+    0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+  );
+  const __m256i lanes = _mm256_setr_epi32 (0, 4, 0, 0, 0, 0, 0, 0);
+  size_t i;
+  for (i = 0; i + 32 <= length; i += 32) {
+    __m256i chars = _mm256_loadu_si256 ((__m256i *)(string + i));
+    __m256i upper = _mm256_and_si256 (chars, caseMask);
+    __m256i valid = _mm256_or_si256 (
+      _mm256_or_si256 (
+        _mm256_cmpeq_epi8 (upper, _mm256_set1_epi8 ('A')),
+        _mm256_cmpeq_epi8 (upper, _mm256_set1_epi8 ('C'))
+      ),
+      _mm256_or_si256 (
+        _mm256_cmpeq_epi8 (upper, _mm256_set1_epi8 ('G')),
+        _mm256_cmpeq_epi8 (upper, _mm256_set1_epi8 ('T'))
+      )
+    );
+    __m256i code = _mm256_and_si256 (
+      _mm256_shuffle_epi8 (lookup, _mm256_and_si256 (chars, nibbleMask)),
+      valid
+    );
+    __m256i packed = _mm256_madd_epi16 (
+      _mm256_maddubs_epi16 (code, pairWeights), quadWeights
+    );
+    packed = _mm256_permutevar8x32_epi32 (
+      _mm256_shuffle_epi8 (packed, gather), lanes
+    );
+    uint64_t bytes = _mm_cvtsi128_si64 (_mm256_castsi256_si128 (packed));
+    uint64_t bits = ~(uint64_t)(uint32_t)_mm256_movemask_epi8 (valid);
+    memcpy (codes + i / 4, &bytes, sizeof (bytes));
+    ambiguous[i / 64] |= (bits & 0xffffffff) << (i % 64);
+  }
+  return i;
+}
+
+#endif
+
+/**
+ * Encode a strand of DNA into packed 2 bit codes.
+ *
+ * @public
+ * @param string The strand of DNA to encode.
+ * @param length The number of nucleotides to encode.
+ * @param codes The (length + 3) / 4 bytes to store the codes in.
+ * @param ambiguous The (length + 63) / 64 words to store the bitmask in.
+ * @return The number of ambiguous positions found.
+ */
+size_t encodeNucleotides (
+  char * string,
+  size_t length,
+  uint8_t * codes,
+  uint64_t * ambiguous
+) {
+  size_t i = 0;
+  size_t number = 0;
+  memset (ambiguous, 0, (length + 63) / 64 * sizeof (uint64_t));
+#ifdef TOOLS_X86_SIMD
+  if (__builtin_cpu_supports ("avx2")) {
+    i = encodeNucleotidesAVX2 (string, length, codes, ambiguous);
+  }
+  else if (__builtin_cpu_supports ("sse4.1")) {
+    i = encodeNucleotidesSSE (string, length, codes, ambiguous);
+  }
+#endif
+  encodeNucleotidesScalar (string, i, length, codes, ambiguous);
+  for (i = 0; i < (length + 63) / 64; i ++) {
+    number += __builtin_popcountll (ambiguous[i]);
+  }
+  return number;
+}
+
+/**
+ * Gather the next block of nucleotides from sequence data that may be
+ * broken into lines.
+ *
+ * @public
+ * @param string The sequence data.
+ * @param length The number of bytes of sequence data.
+ * @param buffer The buffer to copy the nucleotides into.
+ * @param capacity The size of buffer.
+ * @param block Set to the start of the block of nucleotides.
+ * @param number Set to the number of nucleotides in the block.
+ * @return The number of bytes of sequence data used.
+ */
+size_t readNucleotides (
+  char * string,
+  size_t length,
+  char * buffer,
+  size_t capacity,
+  char ** block,
+  size_t * number
+) {
+  size_t i = 0;
+  size_t j = 0;
+  size_t run, copy;
+  char * lineFeed;
+  run = length < capacity ? length : capacity;
+  /* Use the sequence data in place when there is no line break in it,
+     keeping a carriage-return at the end with the line-feed after it. */
+  if (memchr (string, '\n', run) == NULL) {
+    if (run < length && run > 1 && string[run - 1] == '\r') {
+      run --;
+    }
+    *block = string;
+    *number = run;
+    return run;
+  }
+  /* Copy each line into the buffer without its line break. */
+  while (i < length && j < capacity) {
+    run = length - i;
+    if (run > capacity - j) {
+      run = capacity - j;
+    }
+    lineFeed = memchr (string + i, '\n', run);
+    if (lineFeed != NULL) {
+      run = lineFeed - string - i;
+      copy = run;
+      if (copy > 0 && string[i + copy - 1] == '\r') {
+        copy --;
+      }
+      memcpy (buffer + j, string + i, copy);
+      j += copy;
+      i += run + 1;
+      continue;
+    }
+    copy = run;
+    if (i + run < length && run > 1 && string[i + run - 1] == '\r') {
+      copy --;
+    }
+    memcpy (buffer + j, string + i, copy);
+    j += copy;
+    i += copy;
+    if (copy < run) {
+      break;
+    }
+  }
+  *block = buffer;
+  *number = j;
+  return i;
+}
+
+/**
+ * Add a position to the last run of a list of runs, or start a new run if
+ * it does not follow on from the last run.
+ *
+ * @private
+ * @param runs The list of runs.
+ * @param number The number of runs.
+ * @param capacity The room for runs.
+ * @param position The position to add.
+ * @param base The character of the position.
+ */
+static void addPackedRun (
+  PackedRun ** runs,
+  size_t * number,
+  size_t * capacity,
+  size_t position,
+  char base
+) {
+  PackedRun * last = *number > 0 ? *runs + *number - 1 : NULL;
+  if (
+    last != NULL && last->start + last->length == position &&
+    last->base == base
+  ) {
+    last->length ++;
+    return;
+  }
+  if (*number == *capacity) {
+    *capacity = *capacity > 0 ? 2 * *capacity : 16;
+    *runs = realloc (*runs, *capacity * sizeof (PackedRun));
+  }
+  (*runs)[*number].start = position;
+  (*runs)[*number].length = 1;
+  (*runs)[*number].base = base;
+  (*number) ++;
+}
+
+/**
+ * Find the first run that ends after a position, with a binary search.
+ *
+ * @private
+ * @param runs The list of runs, in order.
+ * @param number The number of runs.
+ * @param position The position.
+ * @return The index of the run, or number if every run ends before the
+ *         position.
+ */
+static size_t findPackedRun (
+  PackedRun * runs,
+  size_t number,
+  size_t position
+) {
+  size_t low = 0;
+  size_t high = number;
+  size_t middle;
+  while (low < high) {
+    middle = low + (high - low) / 2;
+    if (runs[middle].start + runs[middle].length <= position) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+/**
+ * Pack a strand of DNA into 2 bit codes.
+ *
+ * @public
+ * @param string The strand of DNA to pack.
+ * @param length The number of bytes of the strand of DNA.
+ * @return The packed nucleotides, which should be freed with
+ *         freePackedNucleotides.
+ */
+PackedNucleotides * packNucleotides (
+  char * string,
+  size_t length
+) {
+  PackedNucleotides * packed = malloc (sizeof (PackedNucleotides));
+  char buffer[4096];
+  char * block;
+  size_t offset, used, number, i;
+  size_t position = 0;
+  size_t ambiguousCapacity = 0;
+  size_t maskedCapacity = 0;
+  unsigned char c, code;
+  /* There are at most as many nucleotides as bytes.  The extra byte lets
+     encodePackedNucleotides read a byte past the last code. */
+  packed->codes = calloc ((length + 3) / 4 + 1, sizeof (uint8_t));
+  packed->ambiguous = NULL;
+  packed->numAmbiguous = 0;
+  packed->masked = NULL;
+  packed->numMasked = 0;
+  for (offset = 0; offset < length; offset += used) {
+    used = readNucleotides (
+      string + offset, length - offset, buffer, sizeof (buffer), &block,
+      &number
+    );
+    for (i = 0; i < number; i ++, position ++) {
+      c = block[i];
+      code = nucleotideCodes[c];
+      if (code > 3) {
+        addPackedRun (
+          &packed->ambiguous, &packed->numAmbiguous, &ambiguousCapacity,
+          position, toupper (c)
+        );
+      }
+      else {
+        packed->codes[position / 4] |= code << (2 * (position % 4));
+      }
+      if (islower (c)) {
+        addPackedRun (
+          &packed->masked, &packed->numMasked, &maskedCapacity, position, 0
+        );
+      }
+    }
+  }
+  packed->length = position;
+  /* Give back the room taken by line breaks and unused runs. */
+  packed->codes = realloc (packed->codes, (position + 3) / 4 + 1);
+  if (packed->numAmbiguous > 0) {
+    packed->ambiguous = realloc (
+      packed->ambiguous, packed->numAmbiguous * sizeof (PackedRun)
+    );
+  }
+  if (packed->numMasked > 0) {
+    packed->masked = realloc (
+      packed->masked, packed->numMasked * sizeof (PackedRun)
+    );
+  }
+  return packed;
+}
+
+/**
+ * Unpack part of a strand of DNA into characters.
+ *
+ * @public
+ * @param packed The packed nucleotides.
+ * @param start The position of the first nucleotide.
+ * @param length The number of nucleotides to unpack.
+ * @param buffer The length characters to store the nucleotides in.
+ */
+void unpackNucleotides (
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  char * buffer
+) {
+  static const char bases[4] = {'A', 'C', 'G', 'T'};
+  PackedRun * run;
+  size_t i, p, r, first, last;
+  for (i = 0; i < length; i ++) {
+    p = start + i;
+    buffer[i] = bases[(packed->codes[p / 4] >> (2 * (p % 4))) & 3];
+  }
+  /* Put back the ambiguous nucleotides, then the lowercase nucleotides. */
+  r = findPackedRun (packed->ambiguous, packed->numAmbiguous, start);
+  for (; r < packed->numAmbiguous; r ++) {
+    run = &packed->ambiguous[r];
+    if (run->start >= start + length) {
+      break;
+    }
+    first = run->start > start ? run->start : start;
+    last = run->start + run->length < start + length ?
+      run->start + run->length : start + length;
+    memset (buffer + first - start, run->base, last - first);
+  }
+  r = findPackedRun (packed->masked, packed->numMasked, start);
+  for (; r < packed->numMasked; r ++) {
+    run = &packed->masked[r];
+    if (run->start >= start + length) {
+      break;
+    }
+    first = run->start > start ? run->start : start;
+    last = run->start + run->length < start + length ?
+      run->start + run->length : start + length;
+    for (p = first; p < last; p ++) {
+      buffer[p - start] = tolower (buffer[p - start]);
+    }
+  }
+}
+
+/**
+ * Encode part of a strand of packed DNA the same as encodeNucleotides,
+ * directly from the packed codes and the runs of ambiguous nucleotides.
+ *
+ * The codes are copied a byte at a time, shifted when the first nucleotide
+ * is not at the start of a byte, and the bitmask is filled a word at a
+ * time across long runs of ambiguous nucleotides.
+ *
+ * @public
+ * @param packed The packed nucleotides.
+ * @param start The position of the first nucleotide.
+ * @param length The number of nucleotides to encode.
+ * @param codes The (length + 3) / 4 bytes to store the codes in.
+ * @param ambiguous The (length + 63) / 64 words to store the bitmask in.
+ * @return The number of ambiguous positions found.
+ */
+size_t encodePackedNucleotides (
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  uint8_t * codes,
+  uint64_t * ambiguous
+) {
+  PackedRun * run;
+  uint8_t * source = packed->codes + start / 4;
+  size_t shift = 2 * (start % 4);
+  size_t bytes = (length + 3) / 4;
+  size_t i, r, first, last;
+  size_t number = 0;
+  if (shift == 0) {
+    memcpy (codes, source, bytes);
+  }
+  else {
+    for (i = 0; i < bytes; i ++) {
+      codes[i] = (source[i] >> shift) | (source[i + 1] << (8 - shift));
+    }
+  }
+  memset (ambiguous, 0, (length + 63) / 64 * sizeof (uint64_t));
+  r = findPackedRun (packed->ambiguous, packed->numAmbiguous, start);
+  for (; r < packed->numAmbiguous; r ++) {
+    run = &packed->ambiguous[r];
+    if (run->start >= start + length) {
+      break;
+    }
+    first = (run->start > start ? run->start : start) - start;
+    last = (run->start + run->length < start + length ?
+      run->start + run->length : start + length) - start;
+    number += last - first;
+    for (i = first; i < last; ) {
+      if (i % 64 == 0 && last - i >= 64) {
+        ambiguous[i / 64] = UINT64_MAX;
+        i += 64;
+      }
+      else {
+        ambiguous[i / 64] |= (uint64_t)1 << (i % 64);
+        i ++;
+      }
+    }
+  }
+  return number;
+}
+
+/**
+ * Gather and encode the next block of nucleotides from either sequence
+ * data that may be broken into lines or packed nucleotides.
+ *
+ * @public
+ * @param string The sequence data, used when packed is NULL.
+ * @param packed The packed nucleotides, or NULL.
+ * @param offset The byte of the sequence data, or the position of the
+ *        packed nucleotides, to start at.
+ * @param length The number of bytes, or packed nucleotides, left.
+ * @param buffer The buffer to copy the nucleotides into.
+ * @param capacity The size of buffer, a multiple of 64.
+ * @param block Set to the start of the block of nucleotides.
+ * @param number Set to the number of nucleotides in the block.
+ * @param codes The capacity / 4 bytes to store the codes in, or NULL.
+ * @param ambiguous The capacity / 64 words to store the bitmask in.
+ * @return The number of bytes, or packed nucleotides, used.
+ */
+size_t gatherNucleotides (
+  char * string,
+  PackedNucleotides * packed,
+  size_t offset,
+  size_t length,
+  char * buffer,
+  size_t capacity,
+  char ** block,
+  size_t * number,
+  uint8_t * codes,
+  uint64_t * ambiguous
+) {
+  size_t used;
+  if (packed == NULL) {
+    used = readNucleotides (
+      string + offset, length, buffer, capacity, block, number
+    );
+    if (codes != NULL) {
+      encodeNucleotides (*block, *number, codes, ambiguous);
+    }
+    return used;
+  }
+  *number = length < capacity ? length : capacity;
+  if (codes == NULL) {
+    unpackNucleotides (packed, offset, *number, buffer);
+    *block = buffer;
+  }
+  else {
+    encodePackedNucleotides (packed, offset, *number, codes, ambiguous);
+    *block = NULL;
+  }
+  return *number;
+}
+
+/**
+ * Free the memory reserved for packed nucleotides.
+ *
+ * @public
+ * @param packed The packed nucleotides to free.
+ */
+void freePackedNucleotides (
+  PackedNucleotides * packed
+) {
+  free (packed->codes);
+  free (packed->ambiguous);
+  free (packed->masked);
+  free (packed);
+}
+
 /**
  * Test whether or not two nucleotides are equal, taking into account
  * the numerous IUPAC codes that could come into play.
  *
+ * Two nucleotides are equal when their IUPAC bitmasks share a nucleotide,
+ * ie. when some nucleotide could be represented by both of them.  Gaps are
+ * only equal to gaps, and unknown nucleotides to unknown nucleotides.
+ *
  * @param nucleotideA The first of the nucleotides to compare.
  * @param nucleotideB The second of the nucleotides to compare.
  * @return Returns a 0 for false, 1 for true.
  */
 char nucleotideIsEqual (char nucleotideA, char nucleotideB) {
-  char isEqual = 0;
-  char * testString;
-  size_t i;
-  /* Determine which string to use to test for equality by looking at
-     nucleotide A. */
-  switch (tolower (nucleotideA)) {
-    /* Adenine (A) */
-    case 'a' : testString = "arwmdhvn";
-               break;
-    /* Cytosine (C) */
-    case 'c' : testString = "cysmbhvn";
-               break;
-    /* Guanine (G) */
-    case 'g' : testString = "grskbdvn";
-               break;
-    /* Thymine (T) */
-    case 't' : testString = "tywkbdhn";
-               break;
-    /* A or G */
-    case 'r' : testString = "agrn";
-               break;
-    /* C or T */
-    case 'y' : testString = "ctyn";
-               break;
-    /** G or C */
-    case 's' : testString = "gcsn";
-               break;
-    /** A or T */
-    case 'w' : testString = "atwn";
-               break;
-    /* G or T  */
-    case 'k' : testString = "gtkn";
-               break;
-    /* A or C */
-    case 'm' : testString = "acmn";
-               break;
-    /* C or G or T (not A) */
-    case 'b' : testString = "cgtbn";
-               break;
-    /* A or G or T (not C) */
-    case 'd' : testString = "agtdn";
-               break;
-    /* A or C or T (not G) */
-    case 'h' : testString = "acthn";
-               break;
-    /* A or C or G (not T) */
-    case 'v' : testString = "acgvn";
-               break;
-    /** A or C or G or T */
-    case 'n' : testString = "acgtryswkmbdhvn"; 
-               break;
-    /* Gap */
-    case '.' :
-    case '-' : testString = ".-";
-               break;
-    /* Unknown */
-    case '?' : testString = "?";
-               break;
-    /** Unknown IUPAC character. */
-    default  : fprintf (
-                 stderr, "Unrecognized nucleotide code: %c.\n", nucleotideA
-               );
-               return 0;
-               break;
-  }
-  /* Test for equality between the nucleotide B and each character of the
-     test string. */
-  for (i = 0; i < strlen (testString); i ++) {
-    if (testString[i] == tolower (nucleotideB)) {
-      isEqual = 1;
-      break;
-    }
+  unsigned char maskA = nucleotideMasks[(unsigned char)nucleotideA];
+  unsigned char maskB = nucleotideMasks[(unsigned char)nucleotideB];
+  if (maskA == 0) {
+    fprintf (stderr, "Unrecognized nucleotide code: %c.\n", nucleotideA);
+    return 0;
   }
-  return isEqual;
+  return (maskA & maskB) != 0;
 }
 
 /**
@@ -316,6 +884,33 @@ size_t power (size_t base, size_t exp) {
   return result;
 }
 
+/**
+ * Scrambles the bits of a 64 bit number using the finalizer of SplitMix64.
+ *
+ * @private
+ * @param z The number to scramble.
+ * @return The scrambled number.
+ */
+static uint64_t mixBits (uint64_t z) {
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/**
+ * Generates a random number from a counter.
+ *
+ * @public
+ * @param seed The seed of the random number generator.
+ * @param stream The stream of random numbers to draw from.
+ * @param counter The position of the random number in the stream.
+ * @return The random number.
+ */
+uint64_t randomNumber (uint64_t seed, uint64_t stream, uint64_t counter) {
+  uint64_t key = mixBits (seed ^ mixBits (stream + 0x9e3779b97f4a7c15ULL));
+  return mixBits (key + (counter + 1) * 0x9e3779b97f4a7c15ULL);
+}
+
 /**
  * Calculates the number of digits in a number.
  *
@@ -35,11 +35,50 @@
 #ifndef _OLIGO_TOOLS_H
 #define _OLIGO_TOOLS_H
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
+/**
+ * The 2 bit code of each character: A = 0, C = 1, G = 2, T = 3.  Every other
+ * character is given the code 4.
+ */
+extern const unsigned char nucleotideCodes[256];
+
+/**
+ * The IUPAC bitmask of each character: A = 1, C = 2, G = 4 and T = 8, with
+ * each ambiguity code the union of the nucleotides it stands for (N = 15).
+ * Gaps (. and -) are given 16, unknown nucleotides (?) 32, and every other
+ * character 0.
+ */
+extern const unsigned char nucleotideMasks[256];
+
+/**
+ * A run of positions in packed nucleotides.
+ */
+typedef struct PackedRun {
+  size_t start;                    /**< The first position of the run. */
+  size_t length;                   /**< The number of positions. */
+  char base;                       /**< The character of the run. */
+} PackedRun;
+
+/**
+ * Nucleotides packed into 2 bit codes, the same as encodeNucleotides, with
+ * the runs of ambiguous nucleotides and soft-masked (lowercase)
+ * nucleotides kept in lists, like the UCSC .2bit format.  Each ambiguous
+ * run holds a single character, stored as 0 in the codes.
+ */
+typedef struct PackedNucleotides {
+  uint8_t * codes;                 /**< The 2 bit codes, four to a byte. */
+  size_t length;                   /**< The number of nucleotides. */
+  PackedRun * ambiguous;           /**< The runs of ambiguous nucleotides. */
+  size_t numAmbiguous;             /**< The number of ambiguous runs. */
+  PackedRun * masked;              /**< The runs of lowercase nucleotides. */
+  size_t numMasked;                /**< The number of lowercase runs. */
+} PackedNucleotides;
+
 /**
  * Removes line-feed and carriage-return characters from the end of a string.
  *
@@ -77,10 +116,157 @@ extern char * complement (char * string);
  */
 extern char * reverseComplement (char * string);
 
+/**
+ * Encode a strand of DNA into packed 2 bit codes.
+ *
+ * Four nucleotides are packed into each byte of codes, the first nucleotide
+ * in the lowest two bits, using A = 0, C = 1, G = 2 and T = 3.  Characters
+ * other than A, C, G and T (in either case) are stored as 0 in codes and
+ * flagged in the ambiguous bitmask, bit i % 64 of word i / 64 for position
+ * i.  The work is done with AVX2 or SSE4.1 instructions when the processor
+ * supports them.
+ *
+ * @param string The strand of DNA to encode.
+ * @param length The number of nucleotides to encode.
+ * @param codes The (length + 3) / 4 bytes to store the codes in.
+ * @param ambiguous The (length + 63) / 64 words to store the bitmask in.
+ * @return The number of ambiguous positions found.
+ */
+extern size_t encodeNucleotides (
+  char * string,
+  size_t length,
+  uint8_t * codes,
+  uint64_t * ambiguous
+);
+
+/**
+ * Gather the next block of nucleotides from sequence data that may be
+ * broken into lines.
+ *
+ * Line-feed characters, and carriage-return characters in front of them,
+ * are skipped.  When the next capacity bytes hold no line break, the block
+ * is the sequence data itself, otherwise the nucleotides are copied into
+ * buffer.
+ *
+ * @param string The sequence data.
+ * @param length The number of bytes of sequence data.
+ * @param buffer The buffer to copy the nucleotides into.
+ * @param capacity The size of buffer.
+ * @param block Set to the start of the block of nucleotides.
+ * @param number Set to the number of nucleotides in the block.
+ * @return The number of bytes of sequence data used.
+ */
+extern size_t readNucleotides (
+  char * string,
+  size_t length,
+  char * buffer,
+  size_t capacity,
+  char ** block,
+  size_t * number
+);
+
+/**
+ * Pack a strand of DNA into 2 bit codes.
+ *
+ * Line-feed characters, and carriage-return characters in front of them,
+ * are skipped.  Characters other than A, C, G and T are kept in runs of
+ * the same character, and lowercase characters in runs of their own, so
+ * unpackNucleotides gives back the original characters.
+ *
+ * @param string The strand of DNA to pack.
+ * @param length The number of bytes of the strand of DNA.
+ * @return The packed nucleotides, which should be freed with
+ *         freePackedNucleotides.
+ */
+extern PackedNucleotides * packNucleotides (
+  char * string,
+  size_t length
+);
+
+/**
+ * Unpack part of a strand of DNA into characters.
+ *
+ * @param packed The packed nucleotides.
+ * @param start The position of the first nucleotide.
+ * @param length The number of nucleotides to unpack.
+ * @param buffer The length characters to store the nucleotides in.
+ */
+extern void unpackNucleotides (
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  char * buffer
+);
+
+/**
+ * Encode part of a strand of packed DNA the same as encodeNucleotides,
+ * directly from the packed codes and the runs of ambiguous nucleotides.
+ *
+ * @param packed The packed nucleotides.
+ * @param start The position of the first nucleotide.
+ * @param length The number of nucleotides to encode.
+ * @param codes The (length + 3) / 4 bytes to store the codes in.
+ * @param ambiguous The (length + 63) / 64 words to store the bitmask in.
+ * @return The number of ambiguous positions found.
+ */
+extern size_t encodePackedNucleotides (
+  PackedNucleotides * packed,
+  size_t start,
+  size_t length,
+  uint8_t * codes,
+  uint64_t * ambiguous
+);
+
+/**
+ * Gather and encode the next block of nucleotides from either sequence
+ * data that may be broken into lines (see readNucleotides) or packed
+ * nucleotides (see encodePackedNucleotides).
+ *
+ * When codes is NULL the nucleotides are not encoded, and the characters
+ * of packed nucleotides are unpacked into buffer instead.  Otherwise the
+ * block of packed nucleotides is only encoded, and block is set to NULL.
+ *
+ * @param string The sequence data, used when packed is NULL.
+ * @param packed The packed nucleotides, or NULL.
+ * @param offset The byte of the sequence data, or the position of the
+ *        packed nucleotides, to start at.
+ * @param length The number of bytes, or packed nucleotides, left.
+ * @param buffer The buffer to copy the nucleotides into.
+ * @param capacity The size of buffer, a multiple of 64.
+ * @param block Set to the start of the block of nucleotides.
+ * @param number Set to the number of nucleotides in the block.
+ * @param codes The capacity / 4 bytes to store the codes in, or NULL.
+ * @param ambiguous The capacity / 64 words to store the bitmask in.
+ * @return The number of bytes, or packed nucleotides, used.
+ */
+extern size_t gatherNucleotides (
+  char * string,
+  PackedNucleotides * packed,
+  size_t offset,
+  size_t length,
+  char * buffer,
+  size_t capacity,
+  char ** block,
+  size_t * number,
+  uint8_t * codes,
+  uint64_t * ambiguous
+);
+
+/**
+ * Free the memory reserved for packed nucleotides.
+ *
+ * @param packed The packed nucleotides to free.
+ */
+extern void freePackedNucleotides (
+  PackedNucleotides * packed
+);
+
 /**
  * Test whether or not two nucleotides are equal, taking into account
  * the numerous IUPAC codes that could come into play.
  *
+ * Two nucleotides are equal when their IUPAC bitmasks share a nucleotide.
+ *
  * @param nucleotideA The first of the nucleotides to compare.
  * @param nucleotideB The second of the nucleotides to compare.
  * @return Returns a 0 for false, 1 for true.
@@ -107,6 +293,20 @@ extern char sequenceIsEqual (char * sequenceA, char * sequenceB);
  */
 extern size_t power (size_t base, size_t exp);
 
+/**
+ * Generates a random number from a counter.
+ *
+ * The number depends only on the seed, stream and counter provided, so the
+ * same arguments always produce the same number no matter which thread asks
+ * for it or in what order.
+ *
+ * @param seed The seed of the random number generator.
+ * @param stream The stream of random numbers to draw from.
+ * @param counter The position of the random number in the stream.
+ * @return The random number.
+ */
+extern uint64_t randomNumber (uint64_t seed, uint64_t stream, uint64_t counter);
+
 /**
  * Calculates the number of digits in a number.
  *
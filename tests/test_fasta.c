@@ -117,6 +117,377 @@ START_TEST (test_fasta_next_sequence) {
   freeSequence (seq);
 } END_TEST
 
+START_TEST (test_fasta_index) {
+  Sequence * seq;
+  size_t i = 0;
+  /* The indexed lengths must match the parsed sequences. */
+  while (nextSequence (fasta, &seq)) {
+    ck_assert_str_eq (getIdentifier (seq), getIdentifierByIndex (fasta, i));
+    ck_assert_int_eq (getSequenceLength (seq), fasta->lengths[i]);
+    freeSequence (seq);
+    i ++;
+  }
+  ck_assert_int_eq (i, 3);
+  ck_assert_int_eq (fasta->offsets[0], 0);
+  ck_assert_int_eq (fasta->lengths[0], 8);
+  /* The line lengths used by the index file. */
+  ck_assert_int_eq (fasta->sequenceOffsets[0], 32);
+  ck_assert_int_eq (fasta->lineBases[0], 8);
+  ck_assert_int_eq (fasta->lineWidths[0], 9);
+  ck_assert_int_eq (fasta->sequenceOffsets[2], 2498);
+  ck_assert_int_eq (fasta->lineBases[2], 70);
+  ck_assert_int_eq (fasta->lineWidths[2], 71);
+} END_TEST
+
+START_TEST (test_fasta_subsequence) {
+  Sequence * seq;
+  char * subsequence;
+  subsequence = getSubsequence (fasta, 0, 2, 4);
+  ck_assert_str_eq (subsequence, "gttg");
+  free (subsequence);
+  /* The subsequence is cut short at the end of the sequence. */
+  subsequence = getSubsequence (fasta, 0, 6, 10);
+  ck_assert_str_eq (subsequence, "ca");
+  free (subsequence);
+  ck_assert_ptr_eq (getSubsequence (fasta, 0, 9, 1), NULL);
+  ck_assert_ptr_eq (getSubsequence (fasta, 3, 0, 1), NULL);
+  /* A subsequence spanning several lines. */
+  nextSequence (fasta, &seq);
+  freeSequence (seq);
+  nextSequence (fasta, &seq);
+  subsequence = getSubsequence (fasta, 1, 65, 150);
+  ck_assert_int_eq (strlen (subsequence), 150);
+  ck_assert (strncmp (subsequence, getSequence (seq) + 65, 150) == 0);
+  free (subsequence);
+  freeSequence (seq);
+} END_TEST
+
+START_TEST (test_fasta_next_sequence_view) {
+  Sequence * seq;
+  Sequence * view;
+  char * data;
+  size_t bytes;
+  size_t i, j;
+  ck_assert_ptr_ne (fasta->map, NULL);
+  /* Skip the first sequence, then compare the views of the others with
+     the parsed sequences. */
+  nextSequenceView (fasta, &view);
+  freeSequence (view);
+  fasta->current = 1;
+  for (i = 1; i < 3; i ++) {
+    nextSequenceView (fasta, &view);
+    fasta->current = i;
+    nextSequence (fasta, &seq);
+    ck_assert_str_eq (getIdentifier (view), getIdentifier (seq));
+    ck_assert_int_eq (getSequenceLength (view), getSequenceLength (seq));
+    data = getSequenceRange (view, 60, 20, &bytes);
+    ck_assert_int_eq (bytes, 21);
+    for (j = 0; j < 10; j ++) {
+      ck_assert_int_eq (data[j], getSequence (seq)[60 + j]);
+    }
+    ck_assert_int_eq (data[10], '\n');
+    ck_assert_int_eq (data[11], getSequence (seq)[70]);
+    freeSequence (view);
+    freeSequence (seq);
+  }
+} END_TEST
+
+START_TEST (test_fasta_compressed) {
+  char * files[2] = {"test_gzip.fa.gz", "test_bgzf.fa.gz"};
+  Fasta * compressed;
+  Sequence * seq;
+  Sequence * expected;
+  char * subsequence;
+  char * expectedSubsequence;
+  size_t i;
+  /* Gzip and BGZF files hold the same sequences as the fasta file. */
+  for (i = 0; i < 2; i ++) {
+    compressed = newFasta (files[i]);
+    ck_assert_ptr_ne (compressed, NULL);
+    ck_assert_ptr_eq (compressed->map, NULL);
+    /* Only the BGZF file can seek, the gzip file is read as a stream. */
+    ck_assert_int_eq (isStream (compressed), i == 0);
+    fasta->current = 0;
+    while (nextSequence (fasta, &expected)) {
+      ck_assert (nextSequenceView (compressed, &seq));
+      ck_assert_str_eq (getIdentifier (seq), getIdentifier (expected));
+      ck_assert_str_eq (getDescription (seq), getDescription (expected));
+      ck_assert_str_eq (getSequence (seq), getSequence (expected));
+      freeSequence (expected);
+      freeSequence (seq);
+    }
+    ck_assert (! nextSequence (compressed, &seq));
+    freeFasta (compressed);
+  }
+  /* The BGZF file can be read again from its index file. */
+  compressed = newFasta ("test_bgzf.fa.gz");
+  ck_assert_int_eq (compressed->offsets[2], FASTA_UNKNOWN_OFFSET);
+  compressed->current = 2;
+  nextSequence (compressed, &seq);
+  ck_assert_str_eq (getIdentifier (seq), "gb|CP000240.1|:c28351-26084");
+  freeSequence (seq);
+  subsequence = getSubsequence (compressed, 2, 100, 50);
+  expectedSubsequence = getSubsequence (fasta, 2, 100, 50);
+  ck_assert_str_eq (subsequence, expectedSubsequence);
+  free (subsequence);
+  free (expectedSubsequence);
+  freeFasta (compressed);
+} END_TEST
+
+START_TEST (test_fasta_stream) {
+  Fasta * stream = newFastaStream (fopen ("test_fasta.fa", "r"));
+  Sequence * seq;
+  Sequence * expected;
+  char ** ids;
+  ck_assert_ptr_ne (stream, NULL);
+  ck_assert_int_eq (numberSequences (stream), 0);
+  /* Sequences that are too short are skipped while the stream is read. */
+  setMinimumLength (stream, 2000);
+  setMinimumLength (fasta, 2000);
+  while (nextSequence (fasta, &expected)) {
+    ck_assert (nextSequence (stream, &seq));
+    ck_assert_str_eq (getIdentifier (seq), getIdentifier (expected));
+    ck_assert_str_eq (getDescription (seq), getDescription (expected));
+    ck_assert_str_eq (getSequence (seq), getSequence (expected));
+    freeSequence (expected);
+    freeSequence (seq);
+  }
+  ck_assert (! nextSequence (stream, &seq));
+  /* The sequences read are remembered. */
+  ck_assert_int_eq (numberSequences (stream), 2);
+  ids = getIdentifiers (stream);
+  ck_assert_str_eq (ids[0], "gb|CP000239.1|:2536947-2539214");
+  free (ids);
+  ck_assert_ptr_eq (getSubsequence (stream, 0, 0, 8), NULL);
+  freeFasta (stream);
+} END_TEST
+
+START_TEST (test_fasta_next_sequence_into) {
+  Fasta * stream = newFastaStream (fopen ("test_fasta.fa", "r"));
+  Sequence * seq = newSequence ();
+  Sequence * view = newSequence ();
+  Sequence * expected;
+  size_t i = 0;
+  /* The same sequence objects are refilled with each sequence. */
+  while (nextSequence (fasta, &expected)) {
+    ck_assert (nextSequenceInto (stream, seq));
+    ck_assert_str_eq (getIdentifier (seq), getIdentifier (expected));
+    ck_assert_str_eq (getDescription (seq), getDescription (expected));
+    ck_assert_str_eq (getSequence (seq), getSequence (expected));
+    freeSequence (expected);
+    i ++;
+  }
+  ck_assert_int_eq (i, 3);
+  ck_assert (! nextSequenceInto (stream, seq));
+  fasta->current = 0;
+  for (i = 0; nextSequenceViewInto (fasta, view); i ++) {
+    ck_assert_str_eq (getIdentifier (view), getIdentifierByIndex (fasta, i));
+    ck_assert_int_eq (getSequenceLength (view), fasta->lengths[i]);
+  }
+  ck_assert_int_eq (i, 3);
+  freeSequence (view);
+  freeSequence (seq);
+  freeFasta (stream);
+} END_TEST
+
+START_TEST (test_fasta_fastq) {
+  Fasta * fastq = newFasta ("test_fastq.fq");
+  Sequence * seq;
+  ck_assert_ptr_ne (fastq, NULL);
+  ck_assert (fastq->fastq);
+  /* Mask the nucleotides with a quality below 20. */
+  setMinimumQuality (fastq, 20);
+  nextSequence (fastq, &seq);
+  ck_assert_str_eq (getIdentifier (seq), "read_1");
+  ck_assert_str_eq (getDescription (seq), "First read");
+  ck_assert_str_eq (getSequence (seq), "ACGTNNCA");
+  freeSequence (seq);
+  /* Sequence and quality lines may be wrapped. */
+  nextSequence (fastq, &seq);
+  ck_assert_str_eq (getIdentifier (seq), "read_2");
+  ck_assert_str_eq (getSequence (seq), "ACGTACGTACGTANGTACGT");
+  freeSequence (seq);
+  /* Empty sequences are skipped, and a quality line may start with an
+     '@'. */
+  nextSequence (fastq, &seq);
+  ck_assert_str_eq (getIdentifier (seq), "read_4");
+  ck_assert_str_eq (getSequence (seq), "AC");
+  freeSequence (seq);
+  ck_assert (! nextSequence (fastq, &seq));
+  ck_assert_int_eq (numberSequences (fastq), 3);
+  freeFasta (fastq);
+} END_TEST
+
+START_TEST (test_fasta_lookup) {
+  Sequence * seq;
+  Sequence * found;
+  char * id;
+  size_t i;
+  /* Look up every sequence by index and by identifier, in reverse. */
+  for (i = fasta->size; i > 0; i --) {
+    id = getIdentifierByIndex (fasta, i - 1);
+    seq = getSequenceByIndex (fasta, i - 1);
+    ck_assert_ptr_ne (seq, NULL);
+    ck_assert_str_eq (getIdentifier (seq), id);
+    ck_assert_int_eq (getSequenceLength (seq), fasta->lengths[i - 1]);
+    found = getSequenceById (fasta, id);
+    ck_assert_ptr_ne (found, NULL);
+    ck_assert_str_eq (getIdentifier (found), id);
+    ck_assert_int_eq (getSequenceLength (found), fasta->lengths[i - 1]);
+    freeSequence (found);
+    freeSequence (seq);
+  }
+  ck_assert_ptr_eq (getSequenceByIndex (fasta, fasta->size), NULL);
+  ck_assert_ptr_eq (getIdentifierByIndex (fasta, fasta->size), NULL);
+  ck_assert_ptr_eq (getSequenceById (fasta, "missing"), NULL);
+  /* The lookups do not move the cursor of nextSequence. */
+  ck_assert_int_eq (fasta->current, 0);
+} END_TEST
+
+START_TEST (test_fasta_next_index) {
+  Fasta * stream = newFastaStream (fopen ("test_fasta.fa", "r"));
+  Sequence * seq = newSequence ();
+  Sequence * expected;
+  size_t index;
+  size_t i = 0;
+  /* Claim each index, then read the sequence by its index. */
+  ck_assert (! isStream (fasta));
+  while (nextSequenceIndex (fasta, &index)) {
+    ck_assert_int_eq (index, i);
+    ck_assert (getSequenceByIndexInto (fasta, index, seq));
+    ck_assert (nextSequence (stream, &expected));
+    ck_assert_str_eq (getIdentifier (seq), getIdentifier (expected));
+    ck_assert_int_eq (getSequenceLength (seq), getSequenceLength (expected));
+    freeSequence (expected);
+    i ++;
+  }
+  ck_assert_int_eq (i, 3);
+  ck_assert_int_eq (fasta->current, fasta->size);
+  ck_assert (! getSequenceByIndexInto (fasta, fasta->size, seq));
+  /* A stream has no indices to claim. */
+  ck_assert (isStream (stream));
+  ck_assert (! nextSequenceIndex (stream, &index));
+  freeSequence (seq);
+  freeFasta (stream);
+} END_TEST
+
+START_TEST (test_fasta_short_read) {
+  FILE * file = fopen ("test_short.fa", "w");
+  Fasta * irregular;
+  Sequence * seq = newSequence ();
+  /* Lines of different lengths are read with positional reads. */
+  fprintf (file, ">first\nACGTACGT\nACG\nACGTA\n>second\nACGTACGT\nAC\n");
+  fclose (file);
+  irregular = newFasta ("test_short.fa");
+  ck_assert_ptr_ne (irregular, NULL);
+  ck_assert_ptr_eq (irregular->map, NULL);
+  ck_assert (getSequenceByIndexInto (irregular, 1, seq));
+  ck_assert_str_eq (getSequence (seq), "ACGTACGTAC");
+  /* A sequence cut short by the end of the file is not returned. */
+  truncate ("test_short.fa", 40);
+  ck_assert (! getSequenceByIndexInto (irregular, 1, seq));
+  ck_assert (getSequenceByIndexInto (irregular, 0, seq));
+  freeSequence (seq);
+  freeFasta (irregular);
+  remove ("test_short.fa");
+  remove ("test_short.fa.fai");
+} END_TEST
+
+START_TEST (test_fasta_twobit) {
+  Fasta * twoBit = newFasta ("test_fasta.2bit");
+  Sequence * seq;
+  Sequence * expected;
+  char * subsequence;
+  char * expectedSubsequence;
+  ck_assert_ptr_ne (twoBit, NULL);
+  ck_assert_int_eq (twoBit->twoBit, 1);
+  ck_assert_int_eq (numberSequences (twoBit), numberSequences (fasta));
+  /* The .2bit file holds the same sequences as the fasta file, as packed
+     sequences. */
+  while (nextSequence (fasta, &expected)) {
+    ck_assert (nextSequenceView (twoBit, &seq));
+    ck_assert_ptr_ne (getPackedSequence (seq), NULL);
+    ck_assert_str_eq (getIdentifier (seq), getIdentifier (expected));
+    ck_assert_int_eq (getSequenceLength (seq), getSequenceLength (expected));
+    ck_assert_str_eq (getSequence (seq), getSequence (expected));
+    freeSequence (expected);
+    freeSequence (seq);
+  }
+  ck_assert (! nextSequence (twoBit, &seq));
+  subsequence = getSubsequence (twoBit, 2, 100, 50);
+  expectedSubsequence = getSubsequence (fasta, 2, 100, 50);
+  ck_assert_str_eq (subsequence, expectedSubsequence);
+  free (subsequence);
+  free (expectedSubsequence);
+  /* Sequences shorter than the minimum length are skipped. */
+  setMinimumLength (twoBit, 100);
+  ck_assert_int_eq (numberSequences (twoBit), 2);
+  freeFasta (twoBit);
+} END_TEST
+
+START_TEST (test_fasta_chunks) {
+  char * nucleotides = "ACGT";
+  FILE * file = fopen ("test_chunks.fa", "w");
+  Fasta * serial;
+  Fasta * parallel;
+  size_t i, j, length;
+#ifdef _OPENMP
+  int threads = omp_get_max_threads ();
+#endif
+  /* Sequences of many lengths, with one that spans several chunks so
+     that a chunk has no header line. */
+  for (i = 0; i < 100; i ++) {
+    fprintf (file, ">chunk_%zu description %zu\n", i, i);
+    length = i == 50 ? 16384 : 1 + i * 37 % 200;
+    for (j = 0; j < length; j ++) {
+      putc (nucleotides[(i + j) % 4], file);
+      if (j % 60 == 59 || j == length - 1) {
+        putc ('\n', file);
+      }
+    }
+  }
+  fclose (file);
+  /* Index the file on one thread, then in chunks of a few lines on
+     several threads. */
+  setFastaChunkSize (1024);
+#ifdef _OPENMP
+  omp_set_num_threads (1);
+#endif
+  remove ("test_chunks.fa.fai");
+  serial = newFasta ("test_chunks.fa");
+#ifdef _OPENMP
+  omp_set_num_threads (4);
+#endif
+  remove ("test_chunks.fa.fai");
+  parallel = newFasta ("test_chunks.fa");
+#ifdef _OPENMP
+  omp_set_num_threads (threads);
+#endif
+  setFastaChunkSize (FASTA_CHUNK_SIZE);
+  ck_assert_ptr_ne (serial, NULL);
+  ck_assert_ptr_ne (parallel, NULL);
+  ck_assert_int_eq (numberSequences (serial), 100);
+  ck_assert_int_eq (numberSequences (parallel), numberSequences (serial));
+  ck_assert_int_eq (parallel->regular, serial->regular);
+  for (i = 0; i < numberSequences (serial); i ++) {
+    ck_assert_str_eq (
+      getIdentifierByIndex (parallel, i),
+      getIdentifierByIndex (serial, i)
+    );
+    ck_assert_int_eq (parallel->offsets[i], serial->offsets[i]);
+    ck_assert_int_eq (
+      parallel->sequenceOffsets[i],
+      serial->sequenceOffsets[i]
+    );
+    ck_assert_int_eq (parallel->lengths[i], serial->lengths[i]);
+    ck_assert_int_eq (parallel->lineBases[i], serial->lineBases[i]);
+    ck_assert_int_eq (parallel->lineWidths[i], serial->lineWidths[i]);
+  }
+  freeFasta (serial);
+  freeFasta (parallel);
+  remove ("test_chunks.fa");
+  remove ("test_chunks.fa.fai");
+} END_TEST
 
 Suite * fasta_suite (void) {
   Suite *s = suite_create ("Fasta");
@@ -127,6 +498,18 @@ Suite * fasta_suite (void) {
   tcase_add_test (tc_core, test_fasta_identifiers);
   tcase_add_test (tc_core, test_fasta_minimum_length);
   tcase_add_test (tc_core, test_fasta_next_sequence);
+  tcase_add_test (tc_core, test_fasta_index);
+  tcase_add_test (tc_core, test_fasta_subsequence);
+  tcase_add_test (tc_core, test_fasta_next_sequence_view);
+  tcase_add_test (tc_core, test_fasta_compressed);
+  tcase_add_test (tc_core, test_fasta_stream);
+  tcase_add_test (tc_core, test_fasta_next_sequence_into);
+  tcase_add_test (tc_core, test_fasta_fastq);
+  tcase_add_test (tc_core, test_fasta_lookup);
+  tcase_add_test (tc_core, test_fasta_next_index);
+  tcase_add_test (tc_core, test_fasta_short_read);
+  tcase_add_test (tc_core, test_fasta_twobit);
+  tcase_add_test (tc_core, test_fasta_chunks);
   suite_add_tcase (s, tc_core);
   return s;
 }
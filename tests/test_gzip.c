@@ -0,0 +1,197 @@
+/*
+ *  Copyright (c) 2014, Jason M. Wood <sandain@hotmail.com>
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * 
+ *
+ * @file test_gzip.c
+ */
+
+#include <check.h>
+
+#include "../src/gzip.h"
+
+/**
+ * Read the whole of a file into a buffer.
+ */
+static size_t readFile (FILE * file, char * buffer, size_t size) {
+  size_t total = 0;
+  size_t length;
+  while ((length = fread (buffer + total, 1, size - total, file)) > 0) {
+    total += length;
+  }
+  return total;
+}
+
+START_TEST (test_gzip_not_compressed) {
+  ck_assert_ptr_eq (
+    newGzip ("test_fasta.fa"),
+    NULL
+  );
+  ck_assert_ptr_eq (
+    newGzip ("missing.fa.gz"),
+    NULL
+  );
+} END_TEST
+
+START_TEST (test_gzip_stream) {
+  char expected[8192];
+  char data[8192];
+  size_t length;
+  FILE * plain = fopen ("test_fasta.fa", "r");
+  Gzip * gzip = newGzip ("test_gzip.fa.gz");
+  FILE * file = streamGzip (gzip);
+  ck_assert (! gzip->bgzf);
+  /* Read through both gzip members. */
+  length = readFile (plain, expected, sizeof (expected));
+  ck_assert_int_eq (readFile (file, data, sizeof (data)), length);
+  ck_assert (memcmp (data, expected, length) == 0);
+  /* Seek backwards and forwards. */
+  fseek (file, 100, SEEK_SET);
+  ck_assert_int_eq (fread (data, 1, 10, file), 10);
+  ck_assert (memcmp (data, expected + 100, 10) == 0);
+  fseek (file, 3000, SEEK_SET);
+  ck_assert_int_eq (fread (data, 1, 10, file), 10);
+  ck_assert (memcmp (data, expected + 3000, 10) == 0);
+  fseek (file, -20, SEEK_CUR);
+  ck_assert_int_eq (ftell (file), 2990);
+  fclose (file);
+  fclose (plain);
+  freeGzip (gzip);
+} END_TEST
+
+START_TEST (test_gzip_truncated) {
+  char data[8192];
+  size_t length;
+  FILE * file = fopen ("test_gzip.fa.gz", "r");
+  Gzip * gzip;
+  /* Copy the gzip file without the end of its last member. */
+  length = readFile (file, data, sizeof (data));
+  fclose (file);
+  file = fopen ("test_truncated.fa.gz", "w");
+  fwrite (data, 1, length - 100, file);
+  fclose (file);
+  /* The stream fails at the end of the file, instead of ending early. */
+  gzip = newGzip ("test_truncated.fa.gz");
+  ck_assert_ptr_ne (gzip, NULL);
+  file = streamGzip (gzip);
+  readFile (file, data, sizeof (data));
+  ck_assert (ferror (file));
+  fclose (file);
+  freeGzip (gzip);
+  remove ("test_truncated.fa.gz");
+} END_TEST
+
+START_TEST (test_gzip_bgzf) {
+  char expected[8192];
+  char data[8192];
+  size_t length;
+  FILE * plain = fopen ("test_fasta.fa", "r");
+  Gzip * gzip = newGzip ("test_bgzf.fa.gz");
+  FILE * file = streamGzip (gzip);
+  /* The blocks hold 1000 bytes each, followed by an empty block. */
+  length = readFile (plain, expected, sizeof (expected));
+  ck_assert (gzip->bgzf);
+  ck_assert_int_eq (gzip->size, length);
+  ck_assert_int_eq (gzip->blocks, (length + 999) / 1000 + 1);
+  ck_assert_int_eq (readFile (file, data, sizeof (data)), length);
+  ck_assert (memcmp (data, expected, length) == 0);
+  /* Seek straight to the block holding the data. */
+  fseek (file, 2500, SEEK_SET);
+  ck_assert_int_eq (fread (data, 1, 1000, file), 1000);
+  ck_assert (memcmp (data, expected + 2500, 1000) == 0);
+  fseek (file, -10, SEEK_END);
+  ck_assert_int_eq (fread (data, 1, 100, file), 10);
+  ck_assert (memcmp (data, expected + length - 10, 10) == 0);
+  /* The virtual offset holds the block offset and the offset within the
+     block. */
+  ck_assert (
+    getVirtualOffset (gzip, 2500) ==
+    ((uint64_t)gzip->blockOffsets[2] << 16 | 500)
+  );
+  ck_assert (getVirtualOffset (gzip, 0) == 0);
+  ck_assert (getVirtualOffset (gzip, length) == UINT64_MAX);
+  fclose (file);
+  fclose (plain);
+  freeGzip (gzip);
+} END_TEST
+
+START_TEST (test_gzip_bgzf_corrupt) {
+  char data[8192];
+  size_t length;
+  size_t i;
+  FILE * file = fopen ("test_bgzf.fa.gz", "r");
+  Gzip * gzip = newGzip ("test_bgzf.fa.gz");
+  /* Copy the BGZF file, and flip bytes of the deflated data of the third
+     block. */
+  length = readFile (file, data, sizeof (data));
+  fclose (file);
+  for (i = 0; i < 50; i ++) {
+    data[gzip->blockOffsets[2] + 20 + i] ^= 0xff;
+  }
+  freeGzip (gzip);
+  file = fopen ("test_corrupt.fa.gz", "w");
+  fwrite (data, 1, length, file);
+  fclose (file);
+  /* At most the data of the blocks before the corrupt block is read, and
+     then the stream fails. */
+  gzip = newGzip ("test_corrupt.fa.gz");
+  ck_assert_ptr_ne (gzip, NULL);
+  ck_assert (gzip->bgzf);
+  file = streamGzip (gzip);
+  ck_assert (readFile (file, data, sizeof (data)) <= 2000);
+  ck_assert (ferror (file));
+  ck_assert_int_eq (fread (data, 1, 10, file), 0);
+  fclose (file);
+  freeGzip (gzip);
+  remove ("test_corrupt.fa.gz");
+} END_TEST
+
+Suite * gzip_suite (void) {
+  Suite *s = suite_create ("Gzip");
+  /* Core test case */
+  TCase *tc_core = tcase_create ("Core");
+  tcase_add_test (tc_core, test_gzip_not_compressed);
+  tcase_add_test (tc_core, test_gzip_stream);
+  tcase_add_test (tc_core, test_gzip_truncated);
+  tcase_add_test (tc_core, test_gzip_bgzf);
+  tcase_add_test (tc_core, test_gzip_bgzf_corrupt);
+  suite_add_tcase (s, tc_core);
+  return s;
+}
+
+int main (void) {
+  int number_failed;
+  Suite *s = gzip_suite ();
+  SRunner *sr = srunner_create (s);
+  srunner_set_fork_status (sr, CK_NOFORK);
+  srunner_run_all (sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed (sr);
+  srunner_free (sr);
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,391 @@
+/*
+ *  Copyright (c) 2014, Jason M. Wood <sandain@hotmail.com>
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * 
+ *
+ * @file test_kmer.c
+ */
+
+#include <check.h>
+
+#include "../src/kmer.h"
+
+char * testSequence = "acgttgcaACGTTGCAggatccnnacgtacgttgca";
+
+/**
+ * Count the oligos with both methods and compare the results.
+ */
+static int countsAreEqual (
+  char * sequence,
+  size_t oligoLength,
+  size_t stepSize
+) {
+  size_t i;
+  size_t numCombinations = power (4, oligoLength);
+  double * counts = calloc (numCombinations, sizeof (double));
+  double * reference = calloc (numCombinations, sizeof (double));
+  int isEqual = 1;
+  countOligos (
+    sequence, strlen (sequence), oligoLength, stepSize, counts
+  );
+  countOligosReference (
+    sequence, strlen (sequence), oligoLength, stepSize, reference
+  );
+  for (i = 0; i < numCombinations; i ++) {
+    if (counts[i] != reference[i]) {
+      isEqual = 0;
+    }
+  }
+  free (counts);
+  free (reference);
+  return isEqual;
+}
+
+/**
+ * Count a range of oligo lengths in one pass and compare the results with
+ * counting each oligo length on its own.
+ */
+static int rangeIsEqual (
+  char * sequence,
+  size_t minLength,
+  size_t maxLength,
+  int overlapping,
+  int canonical
+) {
+  size_t i, k;
+  size_t length = strlen (sequence);
+  size_t numCombinations;
+  double * counts[KMER_MAX_LENGTH + 1];
+  double totals[KMER_MAX_LENGTH + 1];
+  double * expected;
+  double total;
+  int isEqual = 1;
+  for (k = minLength; k <= maxLength; k ++) {
+    counts[k - minLength] = calloc (power (4, k), sizeof (double));
+    totals[k - minLength] = 0.0;
+  }
+  total = countOligoRange (
+    sequence, length, minLength, maxLength, overlapping, canonical, counts,
+    totals
+  );
+  for (k = minLength; k <= maxLength; k ++) {
+    size_t stepSize = overlapping ? 1 : k;
+    numCombinations = power (4, k);
+    expected = calloc (numCombinations, sizeof (double));
+    if (canonical) {
+      countCanonicalOligos (sequence, length, k, stepSize, expected);
+    }
+    else {
+      countOligos (sequence, length, k, stepSize, expected);
+    }
+    for (i = 0; i < numCombinations; i ++) {
+      if (counts[k - minLength][i] != expected[i]) {
+        isEqual = 0;
+      }
+      totals[k - minLength] -= expected[i];
+    }
+    if (totals[k - minLength] != 0.0) {
+      isEqual = 0;
+    }
+    total -= (double)countOligos (sequence, length, k, stepSize, expected);
+    free (expected);
+    free (counts[k - minLength]);
+  }
+  if (total != 0.0) {
+    isEqual = 0;
+  }
+  return isEqual;
+}
+
+START_TEST (test_kmer_generate) {
+  char ** oligonucleotides = malloc (16 * sizeof (char *));
+  size_t i;
+  generateOligonucleotides (2, oligonucleotides, "", 0);
+  ck_assert_str_eq (oligonucleotides[0], "aa");
+  ck_assert_str_eq (oligonucleotides[1], "ca");
+  ck_assert_str_eq (oligonucleotides[4], "ac");
+  ck_assert_str_eq (oligonucleotides[15], "tt");
+  for (i = 0; i < 16; i ++) {
+    free (oligonucleotides[i]);
+  }
+  free (oligonucleotides);
+} END_TEST
+
+START_TEST (test_kmer_count) {
+  double counts[16] = {0};
+  /* Overlapping dinucleotides of acgttgca: ac cg gt tt tg gc ca. */
+  ck_assert_int_eq (countOligos ("acgttgca", 8, 2, 1, counts), 7);
+  ck_assert_int_eq (counts[4], 1);
+  ck_assert_int_eq (counts[1], 1);
+  ck_assert_int_eq (counts[15], 1);
+  ck_assert_int_eq (counts[0], 0);
+  /* Non-overlapping dinucleotides of acgttgca: ac gt tg ca. */
+  ck_assert_int_eq (countOligos ("acgttgca", 8, 2, 2, counts), 4);
+  ck_assert_int_eq (counts[4], 2);
+  ck_assert_int_eq (counts[1], 2);
+  ck_assert_int_eq (counts[5], 0);
+} END_TEST
+
+START_TEST (test_kmer_ambiguous) {
+  double counts[16] = {0};
+  /* Oligos containing the n are skipped. */
+  ck_assert_int_eq (countOligos ("acnacg", 6, 2, 1, counts), 3);
+  ck_assert_int_eq (counts[4], 2);
+  ck_assert_int_eq (counts[9], 1);
+} END_TEST
+
+START_TEST (test_kmer_kernels) {
+  char sequence[301];
+  size_t i, k;
+  /* Long enough for the unrolled runs of whole words in each kernel. */
+  for (i = 0; i < 300; i ++) {
+    sequence[i] = "acgtACGT"[(i * 7 + i / 5) % 8];
+  }
+  sequence[300] = '\0';
+  for (k = 1; k <= 6; k ++) {
+    ck_assert (countsAreEqual (sequence, k, 1));
+    ck_assert (countsAreEqual (sequence, k, 3));
+  }
+} END_TEST
+
+START_TEST (test_kmer_lines) {
+  double counts[64] = {0};
+  double expected[64] = {0};
+  double spread[64] = {0};
+  size_t i;
+  char * lines = "acgtt\ngcaAC\r\nGTTGC\nAggnn\nacg";
+  char * sequence = "acgttgcaACGTTGCAggnnacg";
+  /* Oligos that span line breaks are counted. */
+  ck_assert_int_eq (
+    countOligos (lines, strlen (lines), 3, 1, counts),
+    countOligos (sequence, strlen (sequence), 3, 1, expected)
+  );
+  ck_assert_int_eq (
+    countCanonicalOligos (lines, strlen (lines), 3, 2, counts),
+    countCanonicalOligos (sequence, strlen (sequence), 3, 2, expected)
+  );
+  ck_assert_int_eq (
+    spreadAmbiguousOligos (lines, strlen (lines), 3, 1, 0, counts),
+    spreadAmbiguousOligos (sequence, strlen (sequence), 3, 1, 0, spread)
+  );
+  for (i = 0; i < 64; i ++) {
+    ck_assert (counts[i] == expected[i] + spread[i]);
+  }
+} END_TEST
+
+START_TEST (test_kmer_spread) {
+  double counts[16] = {0};
+  double total = 0.0;
+  size_t i;
+  /* Only cn and na contain the n, and each is spread over four oligos. */
+  ck_assert_int_eq (spreadAmbiguousOligos ("acnacg", 6, 2, 1, 0, counts), 2);
+  ck_assert (counts[1] == 0.5);
+  ck_assert (counts[0] == 0.25);
+  ck_assert (counts[13] == 0.25);
+  ck_assert (counts[4] == 0.0);
+  /* Only na starts at a multiple of the step size. */
+  memset (counts, 0, sizeof (counts));
+  ck_assert_int_eq (spreadAmbiguousOligos ("acnacg", 6, 2, 2, 0, counts), 1);
+  ck_assert (counts[0] == 0.25);
+  ck_assert (counts[5] == 0.0);
+  /* An r is spread over a and g, while gaps are skipped. */
+  memset (counts, 0, sizeof (counts));
+  ck_assert_int_eq (spreadAmbiguousOligos ("ar-a", 4, 2, 1, 0, counts), 1);
+  ck_assert (counts[0] == 0.5);
+  ck_assert (counts[8] == 0.5);
+  /* Canonical oligos keep the whole count of each ambiguous oligo. */
+  memset (counts, 0, sizeof (counts));
+  ck_assert_int_eq (
+    spreadAmbiguousOligos (
+      testSequence, strlen (testSequence), 2, 1, 1, counts
+    ),
+    3
+  );
+  for (i = 0; i < 16; i ++) {
+    ck_assert (i <= reverseComplementCode (i, 2) || counts[i] == 0.0);
+    total += counts[i];
+  }
+  ck_assert (total == 3.0);
+} END_TEST
+
+START_TEST (test_kmer_reference) {
+  ck_assert (countsAreEqual ("acgttgcaACGTTGCAggatcc", 1, 1));
+  ck_assert (countsAreEqual ("acgttgcaACGTTGCAggatcc", 2, 1));
+  ck_assert (countsAreEqual ("acgttgcaACGTTGCAggatcc", 4, 1));
+  ck_assert (countsAreEqual ("acgttgcaACGTTGCAggatcc", 4, 4));
+  ck_assert (countsAreEqual ("acgttgcaACGTTGCAggatcc", 5, 3));
+  /* The reference method counts an n as every nucleotide. */
+  ck_assert (! countsAreEqual (testSequence, 4, 1));
+} END_TEST
+
+START_TEST (test_kmer_canonical_number) {
+  ck_assert_int_eq (numberCanonicalOligos (1), 2);
+  ck_assert_int_eq (numberCanonicalOligos (2), 10);
+  ck_assert_int_eq (numberCanonicalOligos (3), 32);
+  ck_assert_int_eq (numberCanonicalOligos (4), 136);
+} END_TEST
+
+START_TEST (test_kmer_reverse_complement_code) {
+  /* acg (0 + 1 * 4 + 2 * 16) -> cgt (1 + 2 * 4 + 3 * 16). */
+  ck_assert_int_eq (reverseComplementCode (36, 3), 57);
+  ck_assert_int_eq (reverseComplementCode (57, 3), 36);
+  /* acgt is its own reverse complement. */
+  ck_assert_int_eq (reverseComplementCode (228, 4), 228);
+} END_TEST
+
+START_TEST (test_kmer_canonical) {
+  size_t oligoLength = 4;
+  size_t numCombinations = power (4, oligoLength);
+  size_t length = strlen (testSequence);
+  double * counts = calloc (numCombinations, sizeof (double));
+  double * forward = calloc (numCombinations, sizeof (double));
+  double * collapsed = calloc (
+    numberCanonicalOligos (oligoLength), sizeof (double)
+  );
+  size_t code, reverse, column = 0;
+  ck_assert_int_eq (
+    countCanonicalOligos (testSequence, length, oligoLength, 1, counts),
+    countOligos (testSequence, length, oligoLength, 1, forward)
+  );
+  collapseCanonicalOligos (counts, oligoLength, collapsed);
+  /* Each canonical oligo is the sum of the oligo and its reverse
+     complement on the forward strand. */
+  for (code = 0; code < numCombinations; code ++) {
+    reverse = reverseComplementCode (code, oligoLength);
+    if (code > reverse) {
+      ck_assert_int_eq (counts[code], 0);
+      continue;
+    }
+    if (code == reverse) {
+      ck_assert_int_eq (collapsed[column], forward[code]);
+    }
+    else {
+      ck_assert_int_eq (collapsed[column], forward[code] + forward[reverse]);
+    }
+    column ++;
+  }
+  ck_assert_int_eq (column, numberCanonicalOligos (oligoLength));
+  free (counts);
+  free (forward);
+  free (collapsed);
+} END_TEST
+
+START_TEST (test_kmer_range) {
+  ck_assert (rangeIsEqual (testSequence, 1, 5, 1, 0));
+  ck_assert (rangeIsEqual (testSequence, 1, 5, 0, 0));
+  ck_assert (rangeIsEqual (testSequence, 2, 4, 1, 1));
+  ck_assert (rangeIsEqual (testSequence, 2, 4, 0, 1));
+  ck_assert (rangeIsEqual ("acgt", 3, 6, 1, 0));
+} END_TEST
+
+START_TEST (test_kmer_packed) {
+  double counts[4096] = {0};
+  double expected[4096] = {0};
+  double rangeCounts[3][4096] = {{0}};
+  double rangeExpected[3][4096] = {{0}};
+  double * rangeBlocks[3] = {rangeCounts[0], rangeCounts[1], rangeCounts[2]};
+  double * expectedBlocks[3] = {
+    rangeExpected[0], rangeExpected[1], rangeExpected[2]
+  };
+  double totals[3] = {0};
+  double expectedTotals[3] = {0};
+  char * sequence = "acgtTGCANNNNNACGTRTGCAacgtACGTTGCAacgtTGCAggccNaattACGT"
+    "TGCAACGTacgtTGCAACGTTGCAACGTYGCAACGTTGCA";
+  size_t length = strlen (sequence);
+  size_t start = 5;
+  size_t k;
+  PackedNucleotides * packed = packNucleotides (sequence, length);
+  /* Counting the packed nucleotides gives the same counts as counting the
+     characters. */
+  for (k = 1; k <= 6; k ++) {
+    ck_assert_int_eq (
+      countPackedOligos (packed, start, length - start, k, 1, counts),
+      countOligos (sequence + start, length - start, k, 1, expected)
+    );
+    ck_assert_int_eq (
+      countPackedCanonicalOligos (packed, start, length - start, k, k, counts),
+      countCanonicalOligos (sequence + start, length - start, k, k, expected)
+    );
+    ck_assert_int_eq (
+      spreadPackedAmbiguousOligos (
+        packed, start, length - start, k, 1, 1, counts
+      ),
+      spreadAmbiguousOligos (
+        sequence + start, length - start, k, 1, 1, expected
+      )
+    );
+  }
+  for (k = 0; k < 4096; k ++) {
+    ck_assert (counts[k] == expected[k]);
+  }
+  ck_assert_int_eq (
+    countPackedOligoRange (
+      packed, start, length - start, 2, 4, 0, 1, rangeBlocks, totals
+    ),
+    countOligoRange (
+      sequence + start, length - start, 2, 4, 0, 1, expectedBlocks,
+      expectedTotals
+    )
+  );
+  for (k = 0; k < 256; k ++) {
+    ck_assert (rangeCounts[2][k] == rangeExpected[2][k]);
+  }
+  freePackedNucleotides (packed);
+} END_TEST
+
+Suite * kmer_suite (void) {
+  Suite *s = suite_create ("Kmer");
+  /* Core test case */
+  TCase *tc_core = tcase_create ("Core");
+  tcase_add_test (tc_core, test_kmer_generate);
+  tcase_add_test (tc_core, test_kmer_count);
+  tcase_add_test (tc_core, test_kmer_ambiguous);
+  tcase_add_test (tc_core, test_kmer_kernels);
+  tcase_add_test (tc_core, test_kmer_lines);
+  tcase_add_test (tc_core, test_kmer_spread);
+  tcase_add_test (tc_core, test_kmer_reference);
+  tcase_add_test (tc_core, test_kmer_canonical_number);
+  tcase_add_test (tc_core, test_kmer_reverse_complement_code);
+  tcase_add_test (tc_core, test_kmer_canonical);
+  tcase_add_test (tc_core, test_kmer_range);
+  tcase_add_test (tc_core, test_kmer_packed);
+  suite_add_tcase (s, tc_core);
+  return s;
+}
+
+int main (void) {
+  int number_failed;
+  Suite *s = kmer_suite ();
+  SRunner *sr = srunner_create (s);
+  srunner_set_fork_status (sr, CK_NOFORK);
+  srunner_run_all (sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed (sr);
+  srunner_free (sr);
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
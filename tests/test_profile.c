@@ -0,0 +1,156 @@
+/*
+ *  Copyright (c) 2014, Jason M. Wood <sandain@hotmail.com>
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * 
+ *
+ * @file test_profile.c
+ */
+
+#include <check.h>
+
+#include "../src/profile.h"
+
+Profile * profile;
+
+char * testSequence = "acgttgcaACGTTGCAggatccnnacgtacgttgca";
+
+void setup (void) {
+  profile = newProfile (4, 0);
+}
+
+void teardown (void) {
+  freeProfile (profile);
+}
+
+START_TEST (test_profile_count) {
+  size_t numCombinations = power (4, 4);
+  size_t length = strlen (testSequence);
+  double * counts = calloc (numCombinations, sizeof (double));
+  size_t i, j;
+  ck_assert_int_eq (
+    countProfileOligos (profile, testSequence, length, 1),
+    countOligos (testSequence, length, 4, 1, counts)
+  );
+  sortProfile (profile);
+  /* The profile holds exactly the oligos that were counted, in order. */
+  j = 0;
+  for (i = 0; i < numCombinations; i ++) {
+    if (counts[i] > 0) {
+      ck_assert_int_eq (profile->codes[j], i);
+      ck_assert_int_eq (profile->counts[j], counts[i]);
+      j ++;
+    }
+  }
+  ck_assert_int_eq (getProfileSize (profile), j);
+  ck_assert_int_eq (getProfileTotal (profile), 28);
+  free (counts);
+} END_TEST
+
+START_TEST (test_profile_grow) {
+  Profile * large = newProfile (10, 0);
+  size_t length = 20000;
+  char * sequence = malloc (length + 1);
+  size_t i;
+  for (i = 0; i < length; i ++) {
+    sequence[i] = "acgt"[randomNumber (0, 0, i) % 4];
+  }
+  sequence[length] = '\0';
+  ck_assert_int_eq (
+    countProfileOligos (large, sequence, length, 1), length - 9
+  );
+  ck_assert (getProfileSize (large) > PROFILE_INITIAL_CAPACITY);
+  sortProfile (large);
+  for (i = 1; i < getProfileSize (large); i ++) {
+    ck_assert (large->codes[i - 1] < large->codes[i]);
+  }
+  freeProfile (large);
+  free (sequence);
+} END_TEST
+
+START_TEST (test_profile_canonical) {
+  Profile * canonical = newProfile (4, 1);
+  size_t numCombinations = power (4, 4);
+  size_t length = strlen (testSequence);
+  double * counts = calloc (numCombinations, sizeof (double));
+  size_t i;
+  countProfileOligos (canonical, testSequence, length, 1);
+  countCanonicalOligos (testSequence, length, 4, 1, counts);
+  sortProfile (canonical);
+  for (i = 0; i < getProfileSize (canonical); i ++) {
+    ck_assert_int_eq (canonical->counts[i], counts[canonical->codes[i]]);
+  }
+  freeProfile (canonical);
+  free (counts);
+} END_TEST
+
+START_TEST (test_profile_row) {
+  Profile * other = newProfile (4, 0);
+  Profile * profiles[2] = {profile, other};
+  uint64_t * codes;
+  size_t numCodes;
+  double row[4];
+  /* acgt and cgta, then cgta and gtac. */
+  countProfileOligos (profile, "acgta", 5, 1);
+  countProfileOligos (other, "cgtac", 5, 1);
+  sortProfile (profile);
+  sortProfile (other);
+  codes = mergeProfileCodes (profiles, 2, &numCodes);
+  ck_assert_int_eq (numCodes, 3);
+  fillProfileRow (profile, codes, numCodes, row);
+  ck_assert (row[0] + row[1] + row[2] == 1.0);
+  ck_assert (row[0] == 0.5 || row[1] == 0.5 || row[2] == 0.5);
+  fillProfileRow (other, codes, numCodes, row);
+  ck_assert (row[0] + row[1] + row[2] == 1.0);
+  free (codes);
+  freeProfile (other);
+} END_TEST
+
+Suite * profile_suite (void) {
+  Suite *s = suite_create ("Profile");
+  /* Core test case */
+  TCase *tc_core = tcase_create ("Core");
+  tcase_add_checked_fixture (tc_core, setup, teardown);
+  tcase_add_test (tc_core, test_profile_count);
+  tcase_add_test (tc_core, test_profile_grow);
+  tcase_add_test (tc_core, test_profile_canonical);
+  tcase_add_test (tc_core, test_profile_row);
+  suite_add_tcase (s, tc_core);
+  return s;
+}
+
+int main (void) {
+  int number_failed;
+  Suite *s = profile_suite ();
+  SRunner *sr = srunner_create (s);
+  srunner_set_fork_status (sr, CK_NOFORK);
+  srunner_run_all (sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed (sr);
+  srunner_free (sr);
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
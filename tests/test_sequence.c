@@ -95,6 +95,143 @@ START_TEST (test_seq_sequence_length) {
   );
 } END_TEST
 
+START_TEST (test_seq_adopt_sequence) {
+  char * buffer = strdup ("ggatccnn");
+  adoptSequence (seq, buffer, 6);
+  buffer[6] = '\0';
+  ck_assert_ptr_eq (
+    getSequence (seq),
+    buffer
+  );
+  ck_assert_int_eq (
+    getSequenceLength (seq),
+    6
+  );
+} END_TEST
+
+START_TEST (test_seq_view_sequence) {
+  char * data = "acgt\nacgt\r\nac";
+  size_t bytes;
+  Sequence * view = newSequence ();
+  viewSequence (view, data, 10, 4, 5);
+  /* The sequence data of a view is only found by range. */
+  ck_assert_ptr_eq (getSequence (view), NULL);
+  ck_assert_int_eq (
+    getSequenceLength (view),
+    10
+  );
+  ck_assert_ptr_eq (
+    getSequenceRange (view, 2, 4, &bytes),
+    data + 2
+  );
+  ck_assert_int_eq (
+    bytes,
+    5
+  );
+  ck_assert_ptr_eq (
+    getSequenceRange (view, 8, 2, &bytes),
+    data + 10
+  );
+  ck_assert_int_eq (
+    bytes,
+    2
+  );
+  /* The view does not own the sequence data. */
+  freeSequence (view);
+  ck_assert_ptr_eq (
+    getSequenceRange (seq, 2, 4, &bytes),
+    getSequence (seq) + 2
+  );
+  ck_assert_int_eq (
+    bytes,
+    4
+  );
+} END_TEST
+
+START_TEST (test_seq_pack_sequence) {
+  char * data = "acgt\nNCGT\nac";
+  Sequence * view = newSequence ();
+  viewSequence (view, data, 10, 4, 5);
+  packSequence (view);
+  ck_assert_ptr_ne (getPackedSequence (view), NULL);
+  ck_assert_int_eq (
+    getSequenceLength (view),
+    10
+  );
+  /* The sequence data is unpacked on demand. */
+  ck_assert_str_eq (
+    getSequence (view),
+    "acgtNCGTac"
+  );
+  setSequence (view, testSequence);
+  ck_assert_ptr_eq (getPackedSequence (view), NULL);
+  freeSequence (view);
+} END_TEST
+
+START_TEST (test_seq_set_header) {
+  Sequence * record = newSequence ();
+  setHeader (record, "seq1  First record");
+  ck_assert_str_eq (
+    getIdentifier (record),
+    "seq1"
+  );
+  /* The description is found when it is asked for. */
+  ck_assert_int_eq (
+    getDescriptionLength (record),
+    12
+  );
+  ck_assert_str_eq (
+    getDescription (record),
+    "First record"
+  );
+  /* Changing the identifier keeps the description. */
+  setIdentifier (record, testIdentifier);
+  ck_assert_str_eq (
+    getDescription (record),
+    "First record"
+  );
+  setHeader (record, "read2");
+  ck_assert_str_eq (
+    getIdentifier (record),
+    "read2"
+  );
+  ck_assert_str_eq (
+    getDescription (record),
+    ""
+  );
+  freeSequence (record);
+} END_TEST
+
+START_TEST (test_seq_reserve_sequence) {
+  Sequence * record = newSequence ();
+  char * buffer = reserveSequence (record, 8);
+  memcpy (buffer, "ACGTACGT", 8);
+  setSequenceLength (record, 8);
+  ck_assert_str_eq (
+    getSequence (record),
+    "ACGTACGT"
+  );
+  /* A shorter sequence is written over the same buffer. */
+  ck_assert_ptr_eq (reserveSequence (record, 4), buffer);
+  memcpy (buffer, "TTTT", 4);
+  setSequenceLength (record, 4);
+  ck_assert_str_eq (
+    getSequence (record),
+    "TTTT"
+  );
+  /* A view is released, and the data is owned again. */
+  viewSequence (record, testSequence, 4, 0, 0);
+  buffer = reserveSequence (record, 2);
+  ck_assert_ptr_ne (buffer, testSequence);
+  memcpy (buffer, "GG", 2);
+  setSequenceLength (record, 2);
+  ck_assert_int_eq (
+    getSequenceLength (record),
+    2
+  );
+  freeSequence (record);
+} END_TEST
+
 Suite * sequence_suite (void) {
   Suite *s = suite_create ("Sequence");
   /* Core test case */
@@ -106,6 +243,11 @@ Suite * sequence_suite (void) {
   tcase_add_test (tc_core, test_seq_description_length);
   tcase_add_test (tc_core, test_seq_sequence);
   tcase_add_test (tc_core, test_seq_sequence_length);
+  tcase_add_test (tc_core, test_seq_adopt_sequence);
+  tcase_add_test (tc_core, test_seq_view_sequence);
+  tcase_add_test (tc_core, test_seq_pack_sequence);
+  tcase_add_test (tc_core, test_seq_set_header);
+  tcase_add_test (tc_core, test_seq_reserve_sequence);
   suite_add_tcase (s, tc_core);
   return s;
 }
@@ -0,0 +1,191 @@
+/*
+ *  Copyright (c) 2014, Jason M. Wood <sandain@hotmail.com>
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are
+ *  met:
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * 
+ *
+ * @file test_tools.c
+ */
+
+#include <check.h>
+
+#include "../src/tools.h"
+
+START_TEST (test_tools_random_number) {
+  /* The same counter always produces the same number. */
+  ck_assert (randomNumber (1, 2, 3) == randomNumber (1, 2, 3));
+  /* Different seeds, streams and counters produce different numbers. */
+  ck_assert (randomNumber (1, 2, 3) != randomNumber (2, 2, 3));
+  ck_assert (randomNumber (1, 2, 3) != randomNumber (1, 3, 3));
+  ck_assert (randomNumber (1, 2, 3) != randomNumber (1, 2, 4));
+  ck_assert (randomNumber (0, 0, 0) != 0);
+} END_TEST
+
+START_TEST (test_tools_encode_nucleotides) {
+  char * string =
+    "ACGTacgtNACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTACGT"
+    "acgtRacgtacgtacgt-";
+  size_t length = strlen (string);
+  uint8_t codes[(strlen (string) + 3) / 4];
+  uint64_t ambiguous[(strlen (string) + 63) / 64];
+  size_t i;
+  ck_assert_int_eq (encodeNucleotides (string, length, codes, ambiguous), 3);
+  for (i = 0; i < length; i ++) {
+    int code = (codes[i / 4] >> (2 * (i % 4))) & 3;
+    int isAmbiguous = (ambiguous[i / 64] >> (i % 64)) & 1;
+    if (nucleotideCodes[(unsigned char)string[i]] > 3) {
+      ck_assert_int_eq (isAmbiguous, 1);
+      ck_assert_int_eq (code, 0);
+    }
+    else {
+      ck_assert_int_eq (isAmbiguous, 0);
+      ck_assert_int_eq (code, nucleotideCodes[(unsigned char)string[i]]);
+    }
+  }
+  ck_assert_int_eq (codes[0], 0xe4);
+  ck_assert_int_eq (codes[1], 0xe4);
+} END_TEST
+
+START_TEST (test_tools_nucleotide_is_equal) {
+  ck_assert_int_eq (nucleotideMasks['a'], 1);
+  ck_assert_int_eq (nucleotideMasks['T'], 8);
+  ck_assert_int_eq (nucleotideMasks['n'], 15);
+  ck_assert_int_eq (nucleotideMasks['x'], 0);
+  ck_assert (nucleotideIsEqual ('a', 'A'));
+  ck_assert (nucleotideIsEqual ('a', 'r'));
+  ck_assert (nucleotideIsEqual ('r', 'a'));
+  ck_assert (nucleotideIsEqual ('r', 's'));
+  ck_assert (nucleotideIsEqual ('N', 'b'));
+  ck_assert (nucleotideIsEqual ('-', '.'));
+  ck_assert (! nucleotideIsEqual ('a', 'c'));
+  ck_assert (! nucleotideIsEqual ('r', 'y'));
+  ck_assert (! nucleotideIsEqual ('n', '-'));
+  ck_assert (sequenceIsEqual ("acgt", "mnkk"));
+  ck_assert (! sequenceIsEqual ("acgt", "acgg"));
+} END_TEST
+
+START_TEST (test_tools_read_nucleotides) {
+  char buffer[8];
+  char * block;
+  size_t number;
+  char * plain = "acgtacgt";
+  char * lines = "acgt\r\nacgt\nac";
+  /* Sequence data without line breaks is used in place. */
+  ck_assert_int_eq (
+    readNucleotides (plain, 8, buffer, 8, &block, &number), 8
+  );
+  ck_assert_ptr_eq (block, plain);
+  /* Line breaks are skipped. */
+  ck_assert_int_eq (
+    readNucleotides (lines, 13, buffer, 8, &block, &number), 10
+  );
+  ck_assert_ptr_eq (block, buffer);
+  ck_assert_int_eq (number, 8);
+  ck_assert (strncmp (buffer, "acgtacgt", 8) == 0);
+  ck_assert_int_eq (
+    readNucleotides (lines + 10, 3, buffer, 8, &block, &number), 3
+  );
+  ck_assert_int_eq (number, 2);
+  /* A carriage-return is kept with the line-feed after it. */
+  ck_assert_int_eq (
+    readNucleotides (lines, 13, buffer, 5, &block, &number), 4
+  );
+  ck_assert_int_eq (number, 4);
+} END_TEST
+
+START_TEST (test_tools_pack_nucleotides) {
+  char * lines = "ACGTacgtNNNNRACG\nTACGTnnACGTACGTAC\r\nGTACGTACGTACGTACGTAC"
+    "GTACGTACGTACGTACGTAC\nGTACGTACG-ACGT";
+  char string[128];
+  char buffer[128];
+  uint8_t codes[32];
+  uint64_t ambiguous[2];
+  uint8_t packedCodes[32];
+  uint64_t packedAmbiguous[2];
+  size_t length, start, i;
+  PackedNucleotides * packed;
+  /* Pack the nucleotides without the line breaks. */
+  for (i = 0, length = 0; lines[i] != '\0'; i ++) {
+    if (lines[i] != '\n' && lines[i] != '\r') {
+      string[length ++] = lines[i];
+    }
+  }
+  packed = packNucleotides (lines, strlen (lines));
+  ck_assert_int_eq (packed->length, length);
+  ck_assert_int_eq (packed->numAmbiguous, 4);
+  ck_assert_int_eq (packed->numMasked, 2);
+  unpackNucleotides (packed, 0, length, buffer);
+  ck_assert (memcmp (buffer, string, length) == 0);
+  unpackNucleotides (packed, 6, 10, buffer);
+  ck_assert (memcmp (buffer, string + 6, 10) == 0);
+  /* The packed codes match the codes encoded from the characters, at
+     every alignment. */
+  for (start = 0; start < 8; start ++) {
+    ck_assert_int_eq (
+      encodePackedNucleotides (
+        packed, start, length - start, packedCodes, packedAmbiguous
+      ),
+      encodeNucleotides (string + start, length - start, codes, ambiguous)
+    );
+    for (i = 0; i < length - start; i ++) {
+      ck_assert_int_eq (
+        (packedCodes[i / 4] >> (2 * (i % 4))) & 3,
+        (codes[i / 4] >> (2 * (i % 4))) & 3
+      );
+      ck_assert_int_eq (
+        (packedAmbiguous[i / 64] >> (i % 64)) & 1,
+        (ambiguous[i / 64] >> (i % 64)) & 1
+      );
+    }
+  }
+  freePackedNucleotides (packed);
+} END_TEST
+
+Suite * tools_suite (void) {
+  Suite *s = suite_create ("Tools");
+  /* Core test case */
+  TCase *tc_core = tcase_create ("Core");
+  tcase_add_test (tc_core, test_tools_random_number);
+  tcase_add_test (tc_core, test_tools_encode_nucleotides);
+  tcase_add_test (tc_core, test_tools_nucleotide_is_equal);
+  tcase_add_test (tc_core, test_tools_read_nucleotides);
+  tcase_add_test (tc_core, test_tools_pack_nucleotides);
+  suite_add_tcase (s, tc_core);
+  return s;
+}
+
+int main (void) {
+  int number_failed;
+  Suite *s = tools_suite ();
+  SRunner *sr = srunner_create (s);
+  srunner_set_fork_status (sr, CK_NOFORK);
+  srunner_run_all (sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed (sr);
+  srunner_free (sr);
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}